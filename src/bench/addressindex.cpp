@@ -0,0 +1,104 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <index/addressindex.h>
+#include <key.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <cassert>
+
+//! Blocks paying OUTPUTS_PER_BLOCK outputs to the address on top of the 100-block test chain.
+static const int BLOCKS = 10;
+static const int OUTPUTS_PER_BLOCK = 1000;
+
+namespace {
+
+/** An address index over the test chain, extended with blocks paying many outputs to the coinbase key. */
+struct AddressIndexFixture {
+    const std::unique_ptr<TestChain100Setup> setup{std::make_unique<TestChain100Setup>()};
+    AddressIndex addressindex{1 << 24, true};
+    uint256 address;
+
+    AddressIndexFixture()
+    {
+        const CKeyID id = setup->coinbaseKey.GetPubKey().GetID();
+        std::copy(id.begin(), id.end(), address.begin());
+        const CScript script = GetScriptForDestination(PKHash(id));
+
+        FillableSigningProvider keystore;
+        keystore.AddKey(setup->coinbaseKey);
+        for (int i = 0; i < BLOCKS; ++i) {
+            // Split one of the mature coinbases.
+            const CTransactionRef& coinbase = setup->m_coinbase_txns[i];
+            CMutableTransaction tx;
+            tx.vin.emplace_back(COutPoint(coinbase->GetHash(), 0));
+            const CAmount amount = (coinbase->vout[0].nValue - COIN) / OUTPUTS_PER_BLOCK;
+            tx.vout.assign(OUTPUTS_PER_BLOCK, CTxOut(amount, script));
+            std::map<COutPoint, Coin> coins{{tx.vin[0].prevout, Coin(coinbase->vout[0], i + 1, true)}};
+            std::map<int, std::string> input_errors;
+            const bool signed_tx = SignTransaction(tx, &keystore, coins, SIGHASH_ALL, input_errors);
+            assert(signed_tx);
+            setup->CreateAndProcessBlock({tx}, script);
+        }
+
+        const bool started = addressindex.Start(setup->m_node.chainman->ActiveChainstate());
+        assert(started);
+        while (!addressindex.BlockUntilSyncedToCurrentChain()) {
+            UninterruptibleSleep(std::chrono::milliseconds{10});
+        }
+    }
+
+    ~AddressIndexFixture()
+    {
+        addressindex.Stop();
+    }
+};
+
+} // namespace
+
+// The full history of an address, as read by getaddressdeltas and getaddresstxids.
+static void AddressIndexDeltas(benchmark::Bench& bench)
+{
+    AddressIndexFixture fixture;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > deltas;
+    bench.batch(BLOCKS * OUTPUTS_PER_BLOCK).unit("delta").run([&] {
+        deltas.clear();
+        const bool found = fixture.addressindex.FindAddressDeltas(fixture.address, 1, deltas);
+        assert(found && deltas.size() > size_t(BLOCKS * OUTPUTS_PER_BLOCK));
+    });
+}
+
+// The unspent outputs of an address, as read by getaddressutxos.
+static void AddressIndexUnspent(benchmark::Bench& bench)
+{
+    AddressIndexFixture fixture;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent;
+    bench.batch(BLOCKS * OUTPUTS_PER_BLOCK).unit("output").run([&] {
+        unspent.clear();
+        const bool found = fixture.addressindex.FindAddressUnspent(fixture.address, 1, unspent);
+        assert(found && unspent.size() > size_t(BLOCKS * OUTPUTS_PER_BLOCK));
+    });
+}
+
+// The balance record of an address, as read by getaddressbalance.
+static void AddressIndexBalance(benchmark::Bench& bench)
+{
+    AddressIndexFixture fixture;
+    bench.unit("lookup").run([&] {
+        CAddressBalanceValue balance;
+        const bool found = fixture.addressindex.FindAddressBalance(fixture.address, 1, balance);
+        assert(found && balance.txCount > 0);
+    });
+}
+
+BENCHMARK(AddressIndexDeltas);
+BENCHMARK(AddressIndexUnspent);
+BENCHMARK(AddressIndexBalance);
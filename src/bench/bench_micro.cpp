@@ -4,7 +4,9 @@
 
 #include <bench/bench.h>
 
+#include <crypto/blake2b.h>
 #include <crypto/sha256.h>
+#include <crypto/yespower/yespower.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 
@@ -41,6 +43,8 @@ int main(int argc, char** argv)
     ArgsManager argsman;
     SetupBenchArgs(argsman);
     SHA256AutoDetect();
+    Blake2bAutoDetect();
+    YespowerAutoDetect();
     std::string error;
     if (!argsman.ParseParameters(argc, argv, error)) {
         tfm::format(std::cerr, "Error parsing command line arguments: %s\n", error);
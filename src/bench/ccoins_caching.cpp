@@ -6,10 +6,16 @@
 #include <coins.h>
 #include <policy/policy.h>
 #include <script/signingprovider.h>
+#include <script/standard.h>
+#include <random.h>
 #include <test/util/transaction_utils.h>
 
+#include <ostream>
 #include <vector>
 
+//! Coins added to a cache per iteration of the fill and flush benchmarks.
+static const int CACHE_COINS = 100000;
+
 // Microbenchmark for simple accesses to a CCoinsViewCache database. Note from
 // laanwj, "replicating the actual usage patterns of the client is hard though,
 // many times micro-benchmarks of the database showed completely different
@@ -51,4 +57,55 @@ static void CCoinsCaching(benchmark::Bench& bench)
     ECC_Stop();
 }
 
+static std::vector<std::pair<COutPoint, Coin>> MakeCoins()
+{
+    FastRandomContext det_rand{true};
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    for (int i = 0; i < CACHE_COINS; ++i) {
+        CScript script = GetScriptForDestination(PKHash(uint160(det_rand.randbytes(20))));
+        coins.emplace_back(COutPoint(det_rand.rand256(), det_rand.randrange(4)), Coin(CTxOut(det_rand.randrange(50 * COIN), script), i, false));
+    }
+    return coins;
+}
+
+// Adding P2PKH coins to an empty cache, as connecting blocks does during IBD.
+// Also reports how many such coins fit in a MiB of -dbcache.
+static void CCoinsCacheFill(benchmark::Bench& bench)
+{
+    const std::vector<std::pair<COutPoint, Coin>> coins = MakeCoins();
+    CCoinsView coinsDummy;
+    size_t usage = 0;
+    bench.batch(coins.size()).unit("coin").run([&] {
+        CCoinsViewCache cache(&coinsDummy);
+        for (const auto& [outpoint, coin] : coins) {
+            cache.AddCoin(outpoint, Coin(coin), false);
+        }
+        usage = cache.DynamicMemoryUsage();
+    });
+    if (bench.output()) {
+        *bench.output() << "CCoinsCacheFill: " << coins.size() * (1 << 20) / usage << " coins per MiB of cache" << std::endl;
+    }
+}
+
+// Filling a cache and flushing it into its parent cache, as a block's view is
+// flushed into the tip cache; compare with CCoinsCacheFill for the flush time.
+static void CCoinsCacheFlush(benchmark::Bench& bench)
+{
+    const std::vector<std::pair<COutPoint, Coin>> coins = MakeCoins();
+    CCoinsView coinsDummy;
+    CCoinsViewCache parent(&coinsDummy);
+    bench.batch(coins.size()).unit("coin").run([&] {
+        CCoinsViewCache cache(&parent);
+        for (const auto& [outpoint, coin] : coins) {
+            cache.AddCoin(outpoint, Coin(coin), false);
+        }
+        cache.Flush();
+        assert(parent.GetCacheSize() == coins.size());
+        // Drop the parent's coins; the dummy view does not take them.
+        parent.Flush();
+    });
+}
+
 BENCHMARK(CCoinsCaching);
+BENCHMARK(CCoinsCacheFill);
+BENCHMARK(CCoinsCacheFlush);
@@ -4,6 +4,7 @@
 
 
 #include <bench/bench.h>
+#include <crypto/blake2b.h>
 #include <crypto/muhash.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
@@ -72,6 +73,23 @@ static void SHA256D64_1024(benchmark::Bench& bench)
     });
 }
 
+static void BLAKE2B_80b(benchmark::Bench& bench)
+{
+    std::vector<uint8_t> in(80, 0);
+    bench.batch(in.size()).unit("byte").run([&] {
+        const uint256 hash = Blake2b(in.data(), in.data() + in.size());
+        memcpy(in.data(), hash.begin(), 32);
+    });
+}
+
+static void BLAKE2B80_1024(benchmark::Bench& bench)
+{
+    std::vector<uint8_t> in(80 * 1024, 0);
+    bench.batch(in.size()).unit("byte").run([&] {
+        Blake2b80(in.data(), in.data(), 1024);
+    });
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -163,6 +181,8 @@ BENCHMARK(SHA3_256_1M);
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
 BENCHMARK(SHA256D64_1024);
+BENCHMARK(BLAKE2B_80b);
+BENCHMARK(BLAKE2B80_1024);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
 
@@ -4,11 +4,30 @@
 
 #include <bench/data.h>
 
+#include <random.h>
+#include <util/strencodings.h>
+
 namespace benchmark {
 namespace data {
 
 #include <bench/data/block413567.raw.h>
 const std::vector<uint8_t> block413567{std::begin(block413567_raw), std::end(block413567_raw)};
 
+std::string SnapshotCsv(size_t count)
+{
+    FastRandomContext rng(true);
+    std::string csv;
+    for (size_t i = 0; i < count; ++i) {
+        const std::string hash = HexStr(rng.randbytes(20));
+        if (i % 8 == 7) {
+            csv += "OP_HASH160 " + hash + " OP_EQUAL";
+        } else {
+            csv += "OP_DUP OP_HASH160 " + hash + " OP_EQUALVERIFY OP_CHECKSIG";
+        }
+        csv += "," + std::to_string(1 + rng.randrange(1000000000000)) + "\n";
+    }
+    return csv;
+}
+
 } // namespace data
 } // namespace benchmark
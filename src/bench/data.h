@@ -6,6 +6,7 @@
 #define MICRO_BENCH_DATA_H
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace benchmark {
@@ -13,6 +14,12 @@ namespace data {
 
 extern const std::vector<uint8_t> block413567;
 
+/**
+ * A synthetic genesis snapshot in the CSV format served by the snapshot
+ * providers: count P2PKH and P2SH entries, the same on every call.
+ */
+std::string SnapshotCsv(size_t count);
+
 } // namespace data
 } // namespace benchmark
 
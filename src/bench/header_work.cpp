@@ -0,0 +1,110 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <checkqueue.h>
+#include <consensus/params.h>
+#include <crypto/yespower/yespower.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <validation.h>
+
+#include <vector>
+
+static const size_t HEADERS_BATCH = 64;
+
+static std::vector<CBlockHeader> MakeHeaders(size_t count)
+{
+    std::vector<CBlockHeader> headers(count);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        headers[i].nVersion = 0x20000000;
+        headers[i].nTime = 1570625829 + i * 60;
+        headers[i].nBits = 0x1f3fffff;
+        headers[i].nNonce = i;
+    }
+    return headers;
+}
+
+// Index hashes of a HEADERS batch, one at a time.
+static void IndexHash(benchmark::Bench& bench)
+{
+    const std::vector<CBlockHeader> headers = MakeHeaders(HEADERS_BATCH);
+    const std::vector<CBlockHeaderUncached> uncached(headers.begin(), headers.end());
+    bench.batch(uncached.size()).unit("header").run([&] {
+        for (const CBlockHeaderUncached& header : uncached) {
+            ankerl::nanobench::doNotOptimizeAway(header.GetIndexHash());
+        }
+    });
+}
+
+// Work hashes of yespower_lanes() headers on one thread, one at a time.
+static void WorkHashScalar(benchmark::Bench& bench)
+{
+    const std::vector<CBlockHeader> headers = MakeHeaders(yespower_lanes());
+    bench.batch(headers.size()).unit("header").run([&] {
+        for (const CBlockHeader& header : headers) {
+            header.GetWorkHash();
+        }
+    });
+}
+
+// Work hashes of the same headers on one thread, interleaved in one batch.
+static void WorkHashBatch(benchmark::Bench& bench)
+{
+    const std::vector<CBlockHeader> headers = MakeHeaders(yespower_lanes());
+    std::vector<const CBlockHeaderUncached*> header_ptrs;
+    for (const CBlockHeader& header : headers) {
+        header_ptrs.push_back(&header);
+    }
+    std::vector<uint256> hashes(headers.size());
+    bench.batch(headers.size()).unit("header").run([&] {
+        GetWorkHashes(header_ptrs, hashes);
+    });
+}
+
+// Work hash pre-verification of a HEADERS batch, as done by
+// ProcessNewBlockHeaders, with the master thread plus threads_num workers.
+static void HeaderWorkHashes(benchmark::Bench& bench, int threads_num)
+{
+    // The checks stop at the first header that misses its target, so give
+    // every header the easiest target there is and one that meets it.
+    Consensus::Params params;
+    params.powLimit = uint256S("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    std::vector<CBlockHeader> headers = MakeHeaders(HEADERS_BATCH);
+    for (CBlockHeader& header : headers) {
+        header.nBits = UintToArith256(params.powLimit).GetCompact();
+        while (!CheckProofOfWork(header.GetWorkHash(), header.nBits, params)) header.nNonce += HEADERS_BATCH;
+    }
+
+    CCheckQueue<CHeaderWorkCheck> queue{8};
+    queue.StartWorkerThreads(threads_num, "headerpow");
+
+    bench.batch(HEADERS_BATCH).unit("header").run([&] {
+        // Fresh copies so no work hash is cached yet.
+        std::vector<CBlockHeader> batch(headers);
+        std::vector<const CBlockHeader*> header_ptrs;
+        for (const CBlockHeader& header : batch) {
+            header_ptrs.push_back(&header);
+        }
+        std::vector<CHeaderWorkCheck> vChecks = MakeHeaderWorkChecks(header_ptrs, params);
+        CCheckQueueControl<CHeaderWorkCheck> control(&queue);
+        control.Add(vChecks);
+        control.Wait();
+    });
+    queue.StopWorkerThreads();
+}
+
+static void HeaderWorkHashes1Thread(benchmark::Bench& bench) { HeaderWorkHashes(bench, 0); }
+static void HeaderWorkHashes2Threads(benchmark::Bench& bench) { HeaderWorkHashes(bench, 1); }
+static void HeaderWorkHashes4Threads(benchmark::Bench& bench) { HeaderWorkHashes(bench, 3); }
+static void HeaderWorkHashes8Threads(benchmark::Bench& bench) { HeaderWorkHashes(bench, 7); }
+
+BENCHMARK(IndexHash);
+BENCHMARK(WorkHashScalar);
+BENCHMARK(WorkHashBatch);
+BENCHMARK(HeaderWorkHashes1Thread);
+BENCHMARK(HeaderWorkHashes2Threads);
+BENCHMARK(HeaderWorkHashes4Threads);
+BENCHMARK(HeaderWorkHashes8Threads);
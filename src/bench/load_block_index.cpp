@@ -0,0 +1,91 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <cassert>
+#include <memory>
+#include <set>
+#include <vector>
+
+static const size_t BLOCK_INDEX_ENTRIES = 20000;
+
+/** An in-memory block tree database holding a chain of BLOCK_INDEX_ENTRIES headers. */
+static std::unique_ptr<CBlockTreeDB> MakeBlockTree()
+{
+    auto blocktree = std::make_unique<CBlockTreeDB>(1 << 24, true);
+
+    std::vector<uint256> hashes(BLOCK_INDEX_ENTRIES);
+    std::vector<CBlockIndex> entries(BLOCK_INDEX_ENTRIES);
+    std::vector<const CBlockIndex*> blockinfo;
+    for (size_t i = 0; i < BLOCK_INDEX_ENTRIES; ++i) {
+        CBlockHeader header;
+        header.nVersion = 0x20000000;
+        header.hashPrevBlock = i ? hashes[i - 1] : uint256();
+        header.nTime = 1570625829 + i * 60;
+        header.nBits = 0x1f3fffff;
+        header.nNonce = i;
+        hashes[i] = header.GetIndexHash();
+
+        CBlockIndex& entry = entries[i];
+        entry = CBlockIndex(header);
+        entry.phashBlock = &hashes[i];
+        entry.pprev = i ? &entries[i - 1] : nullptr;
+        entry.nHeight = i;
+        entry.nTx = 1;
+        entry.nStatus = BLOCK_VALID_TREE;
+        blockinfo.push_back(&entry);
+    }
+    assert(blocktree->WriteBatchSync({}, 0, blockinfo));
+    return blocktree;
+}
+
+// Decoding, hashing and linking of the block index records alone.
+static void LoadBlockIndexGuts(benchmark::Bench& bench, int threads)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>(CBaseChainParams::REGTEST);
+    const std::unique_ptr<CBlockTreeDB> blocktree = MakeBlockTree();
+
+    BlockManager blockman;
+    bench.batch(BLOCK_INDEX_ENTRIES).unit("entry").run([&] {
+        LOCK(cs_main);
+        const bool ok = blocktree->LoadBlockIndexGuts(
+            Params().GetConsensus(), [](size_t) {},
+            [&](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return blockman.InsertBlockIndex(hash); },
+            threads);
+        assert(ok);
+        assert(blockman.m_block_index.size() == BLOCK_INDEX_ENTRIES);
+        blockman.Unload();
+    });
+}
+
+// The whole of loading the block index at startup.
+static void LoadBlockIndex(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>(CBaseChainParams::REGTEST);
+    const std::unique_ptr<CBlockTreeDB> blocktree = MakeBlockTree();
+
+    BlockManager blockman;
+    std::set<CBlockIndex*, CBlockIndexWorkComparator> candidates;
+    bench.batch(BLOCK_INDEX_ENTRIES).unit("entry").run([&] {
+        LOCK(cs_main);
+        const bool ok = blockman.LoadBlockIndex(Params().GetConsensus(), *blocktree, candidates);
+        assert(ok);
+        assert(blockman.m_block_index.size() == BLOCK_INDEX_ENTRIES);
+        pindexBestHeader = nullptr;
+        blockman.Unload();
+    });
+}
+
+static void LoadBlockIndexGuts1Thread(benchmark::Bench& bench) { LoadBlockIndexGuts(bench, 1); }
+static void LoadBlockIndexGutsAllThreads(benchmark::Bench& bench) { LoadBlockIndexGuts(bench, 0); }
+
+BENCHMARK(LoadBlockIndexGuts1Thread);
+BENCHMARK(LoadBlockIndexGutsAllThreads);
+BENCHMARK(LoadBlockIndex);
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <random.h>
+#include <util/system.h>
+
+#include <cassert>
+#include <vector>
+
+/**
+ * A header chain whose targets follow LWMA3, with solve times scattered
+ * around the target spacing and now and then out of order.
+ */
+static std::vector<CBlockIndex> MakeChain(size_t length, const Consensus::Params& params)
+{
+    FastRandomContext rng(true);
+    std::vector<CBlockIndex> chain(length);
+    for (size_t i = 0; i < length; ++i) {
+        CBlockIndex& block = chain[i];
+        block.pprev = i ? &chain[i - 1] : nullptr;
+        block.nHeight = i;
+        block.nTime = i ? chain[i - 1].nTime - params.nPowTargetSpacing / 2 + rng.randrange(params.nPowTargetSpacing * 3) : 1570625829;
+        block.nBits = i ? GetNextWorkRequired(&chain[i - 1], nullptr, params) : UintToArith256(params.powLimit).GetCompact();
+        block.BuildSkip();
+    }
+    return chain;
+}
+
+// Check the target of every header of a chain, in order, as header sync does.
+static void Lwma3(benchmark::Bench& bench)
+{
+    ArgsManager bench_args;
+    const auto chainparams = CreateChainParams(bench_args, CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainparams->GetConsensus();
+    const std::vector<CBlockIndex> chain = MakeChain(20000, params);
+
+    bench.epochs(3).epochIterations(1).batch(chain.size() - 1).unit("header").run([&] {
+        for (size_t i = 1; i < chain.size(); ++i) {
+            assert(GetNextWorkRequired(&chain[i - 1], nullptr, params) == chain[i].nBits);
+        }
+    });
+}
+
+// The same check, computing every target from scratch.
+static void Lwma3FromScratch(benchmark::Bench& bench)
+{
+    ArgsManager bench_args;
+    const auto chainparams = CreateChainParams(bench_args, CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainparams->GetConsensus();
+    const std::vector<CBlockIndex> chain = MakeChain(1000, params);
+
+    bench.epochs(3).epochIterations(1).batch(chain.size() - 1).unit("header").run([&] {
+        for (size_t i = 1; i < chain.size(); ++i) {
+            assert(Lwma3CalculateNextWorkRequired(&chain[i - 1], params) == chain[i].nBits);
+        }
+    });
+}
+
+BENCHMARK(Lwma3);
+BENCHMARK(Lwma3FromScratch);
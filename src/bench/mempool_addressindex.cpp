@@ -0,0 +1,103 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+//! Transactions in the mempool, each spending from and paying to a few of ADDRESSES addresses.
+static const int MEMPOOL_TXS = 5000;
+static const int ADDRESSES = 100;
+
+namespace {
+
+/** Transactions between a small set of busy addresses, with the coins they spend. */
+struct MempoolAddressFixture {
+    CCoinsView dummy;
+    CCoinsViewCache view{&dummy};
+    std::vector<CTransactionRef> txs;
+    std::vector<CTxDestination> destinations;
+    std::vector<std::pair<uint256, int> > addresses;
+
+    MempoolAddressFixture()
+    {
+        FastRandomContext det_rand{true};
+        for (int i = 0; i < ADDRESSES; ++i) {
+            const CTxDestination dest = PKHash(uint160(det_rand.randbytes(20)));
+            valtype bytes(std::visit(DataVisitor(), dest));
+            bytes.resize(32);
+            destinations.push_back(dest);
+            addresses.emplace_back(uint256(bytes), dest.index());
+        }
+        for (int i = 0; i < MEMPOOL_TXS; ++i) {
+            CMutableTransaction tx;
+            for (int j = 0; j < 2; ++j) {
+                const COutPoint prevout(det_rand.rand256(), 0);
+                const CScript script = GetScriptForDestination(destinations[det_rand.randrange(ADDRESSES)]);
+                view.AddCoin(prevout, Coin(CTxOut(10 * COIN, script), 1, false), false);
+                tx.vin.emplace_back(prevout);
+            }
+            for (int j = 0; j < 2; ++j) {
+                tx.vout.emplace_back(9 * COIN, GetScriptForDestination(destinations[det_rand.randrange(ADDRESSES)]));
+            }
+            txs.push_back(MakeTransactionRef(tx));
+        }
+    }
+
+    void Add(CTxMemPool& pool) const EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+    {
+        LockPoints lp;
+        for (size_t i = 0; i < txs.size(); ++i) {
+            const CTxMemPoolEntry entry(txs[i], 1000, i, 1, false, 4, lp);
+            pool.addAddressIndex(entry, view);
+            pool.addSpentIndex(entry, view);
+            pool.addUnchecked(entry);
+        }
+    }
+};
+
+} // namespace
+
+// Indexing a busy mempool's transactions and dropping them again in blocks.
+static void MempoolAddressIndexAddRemove(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN);
+    const MempoolAddressFixture fixture;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    bench.batch(MEMPOOL_TXS).unit("tx").run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        fixture.Add(pool);
+        for (size_t i = 0; i < fixture.txs.size(); i += 500) {
+            const std::vector<CTransactionRef> block(fixture.txs.begin() + i, fixture.txs.begin() + std::min(i + 500, fixture.txs.size()));
+            pool.removeForBlock(block, 1);
+        }
+        assert(pool.size() == 0);
+    });
+}
+
+// The mempool deltas of a few busy addresses, as read by getaddressmempool.
+static void MempoolAddressIndexQuery(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN);
+    const MempoolAddressFixture fixture;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    fixture.Add(pool);
+    const std::vector<std::pair<uint256, int> > addresses(fixture.addresses.begin(), fixture.addresses.begin() + 4);
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+    bench.unit("query").run([&] {
+        results.clear();
+        const bool found = pool.getAddressIndex(addresses, results);
+        assert(found && !results.empty());
+    });
+}
+
+BENCHMARK(MempoolAddressIndexAddRemove);
+BENCHMARK(MempoolAddressIndexQuery);
@@ -0,0 +1,96 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <consensus/merkle.h>
+#include <fs.h>
+#include <primitives/block.h>
+#include <snapshot.h>
+#include <test/util/setup_common.h>
+#include <util/system.h>
+
+#include <cassert>
+#include <cstdio>
+
+static const size_t SNAPSHOT_ENTRIES = 100000;
+
+namespace {
+
+/** A synthetic snapshot, as CSV and converted, in the snapshot directory of the test datadir. */
+struct SnapshotFixture {
+    const std::unique_ptr<const BasicTestingSetup> testing_setup{MakeNoLogFileContext<const BasicTestingSetup>()};
+    CMutableTransaction coinbase;
+    uint256 merkle_root;
+    fs::path csv_path;
+
+    SnapshotFixture()
+    {
+        const fs::path snapshot_dir = gArgs.GetDataDirBase() / "snapshot";
+        fs::create_directories(snapshot_dir);
+        csv_path = snapshot_dir / "bench.csv";
+
+        const std::string csv = benchmark::data::SnapshotCsv(SNAPSHOT_ENTRIES);
+        FILE* file = fsbridge::fopen(csv_path, "w");
+        assert(file);
+        assert(fwrite(csv.data(), 1, csv.size(), file) == csv.size());
+        fclose(file);
+
+        const std::vector<SnapshotEntry> entries = LoadSnapshot(csv_path);
+        const bool written = WriteSnapshotFile(snapshot_dir / "bench.dat", entries);
+        assert(written);
+
+        coinbase.vin.resize(1);
+        coinbase.vout.resize(1);
+        CMutableTransaction tx = coinbase;
+        for (const SnapshotEntry& entry : entries) {
+            tx.vout.emplace_back(entry.amount, entry.script);
+        }
+        merkle_root = tx.GetHash();
+    }
+};
+
+} // namespace
+
+// Parsing the CSV snapshot, done once when converting it.
+static void SnapshotParseCsv(benchmark::Bench& bench)
+{
+    SnapshotFixture fixture;
+    bench.epochs(3).epochIterations(1).batch(SNAPSHOT_ENTRIES).unit("entry").run([&] {
+        assert(LoadSnapshot(fixture.csv_path).size() == SNAPSHOT_ENTRIES);
+    });
+}
+
+// Mapping the converted snapshot and checking it against the genesis merkle root, done on every start.
+static void SnapshotOpen(benchmark::Bench& bench)
+{
+    SnapshotFixture fixture;
+    bench.batch(SNAPSHOT_ENTRIES).unit("entry").run([&] {
+        const auto snapshot = InitSnapshot("bench", {}, fixture.coinbase, fixture.merkle_root);
+        assert(snapshot->size() == SNAPSHOT_ENTRIES);
+    });
+}
+
+// Building the genesis coinbase from the snapshot and hashing it.
+static void SnapshotGenesis(benchmark::Bench& bench)
+{
+    SnapshotFixture fixture;
+    const auto snapshot = InitSnapshot("bench", {}, fixture.coinbase, fixture.merkle_root);
+    bench.batch(SNAPSHOT_ENTRIES).unit("entry").run([&] {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vout.resize(snapshot->size());
+        for (size_t i = 0; i < snapshot->size(); ++i) {
+            tx.vout[i].nValue = snapshot->GetAmount(i);
+            tx.vout[i].scriptPubKey = *snapshot->GetScript(i);
+        }
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+        ankerl::nanobench::doNotOptimizeAway(BlockMerkleRoot(block));
+    });
+}
+
+BENCHMARK(SnapshotParseCsv);
+BENCHMARK(SnapshotOpen);
+BENCHMARK(SnapshotGenesis);
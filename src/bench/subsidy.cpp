@@ -0,0 +1,36 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <random.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <vector>
+
+// Block subsidies at random heights up to beyond the mainnet subsidy reset,
+// as looked up by ConnectBlock and the RPCs.
+static void BlockSubsidy(benchmark::Bench& bench)
+{
+    ArgsManager bench_args;
+    const auto chainParams = CreateChainParams(bench_args, CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    FastRandomContext rng(true);
+    std::vector<int> heights(1000);
+    for (int& height : heights) {
+        height = rng.randrange(params.nSubsidyHeight + 1000000);
+    }
+
+    CAmount total = 0;
+    bench.batch(heights.size()).unit("height").run([&] {
+        for (int height : heights) {
+            total += GetBlockSubsidy(height, params);
+        }
+    });
+    ankerl::nanobench::doNotOptimizeAway(total);
+}
+
+BENCHMARK(BlockSubsidy);
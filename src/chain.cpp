@@ -5,6 +5,39 @@
 
 #include <chain.h>
 
+#include <algorithm>
+
+void CBlockIndexArena::NewChunk(size_t entries)
+{
+    m_chunks.emplace_back(new CBlockIndex[entries]);
+    m_chunk_size = entries;
+    m_chunk_used = 0;
+}
+
+void CBlockIndexArena::Reserve(size_t count)
+{
+    if (m_chunk_size - m_chunk_used < count) {
+        NewChunk(std::max(count, CHUNK_ENTRIES));
+    }
+}
+
+CBlockIndex* CBlockIndexArena::Allocate()
+{
+    if (m_chunk_used == m_chunk_size) {
+        NewChunk(CHUNK_ENTRIES);
+    }
+    ++m_size;
+    return &m_chunks.back()[m_chunk_used++];
+}
+
+void CBlockIndexArena::Clear()
+{
+    m_chunks.clear();
+    m_chunk_size = 0;
+    m_chunk_used = 0;
+    m_size = 0;
+}
+
 /**
  * CChain implementation
  */
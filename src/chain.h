@@ -13,6 +13,8 @@
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 /**
@@ -127,6 +129,32 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    BLOCK_HAVE_WORKHASH     =   256, //!< yespower work hash is stored in the block index record
+};
+
+/**
+ * A flag set by one thread while others may read it without a lock. Setting
+ * it publishes the data written before, so that a reader that finds it set
+ * also finds that data.
+ */
+class CPublishedFlag
+{
+private:
+    std::atomic<bool> m_set;
+
+public:
+    CPublishedFlag(bool set = false) : m_set{set} {}
+    CPublishedFlag(const CPublishedFlag& other) : m_set{bool(other)} {}
+
+    CPublishedFlag& operator=(const CPublishedFlag& other) { return *this = bool(other); }
+    CPublishedFlag& operator=(bool set)
+    {
+        m_set.store(set, std::memory_order_release);
+        return *this;
+    }
+
+    operator bool() const { return m_set.load(std::memory_order_acquire); }
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -193,8 +221,9 @@ public:
     uint32_t nBits{0};
     uint32_t nNonce{0};
 
-    //! (memory only)
-    bool cacheInit{false};
+    //! Cached yespower work hash. Persisted in the block index record (see BLOCK_HAVE_WORKHASH).
+    //! Filled in once under cs_main, hashes first, and read without it (GetBlockWorkHash).
+    CPublishedFlag cacheInit{false};
     uint256 cacheIndexHash, cacheWorkHash;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
@@ -269,6 +298,7 @@ public:
 
     uint256 GetBlockWorkHash() const
     {
+        if (cacheInit) return cacheWorkHash;
         return GetBlockHeader().GetWorkHash();
     }
 
@@ -348,6 +378,13 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
 class CDiskBlockIndex : public CBlockIndex
 {
 public:
+    /**
+     * First client version whose records may carry the work hash. Records
+     * rewritten by older clients never do, even when they kept
+     * BLOCK_HAVE_WORKHASH set.
+     */
+    static constexpr int WORKHASH_VERSION = 30201;
+
     uint256 hashPrev;
 
     CDiskBlockIndex() {
@@ -356,6 +393,11 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        if (cacheInit) {
+            nStatus |= BLOCK_HAVE_WORKHASH;
+        } else {
+            nStatus &= ~BLOCK_HAVE_WORKHASH;
+        }
     }
 
     SERIALIZE_METHODS(CDiskBlockIndex, obj)
@@ -377,32 +419,38 @@ public:
         READWRITE(obj.nTime);
         READWRITE(obj.nBits);
         READWRITE(obj.nNonce);
+
+        // Records written before the work hash was persisted don't carry it;
+        // those are rewritten once the hash has been computed again.
+        if (_nVersion < WORKHASH_VERSION) {
+            SER_READ(obj, obj.nStatus &= ~BLOCK_HAVE_WORKHASH);
+        } else if (obj.nStatus & BLOCK_HAVE_WORKHASH) {
+            READWRITE(obj.cacheWorkHash);
+        }
     }
 
-    uint256 GetBlockHash() const
+    CBlockHeaderUncached GetUncachedHeader() const
     {
-        CBlockHeader block;
+        CBlockHeaderUncached block;
         block.nVersion        = nVersion;
         block.hashPrevBlock   = hashPrev;
         block.hashMerkleRoot  = hashMerkleRoot;
         block.nTime           = nTime;
         block.nBits           = nBits;
         block.nNonce          = nNonce;
+        return block;
+    }
 
-        return block.GetIndexHash();
+    uint256 GetBlockHash() const
+    {
+        return GetUncachedHeader().GetIndexHash();
     }
 
     uint256 GetBlockWorkHash() const
     {
-        CBlockHeader block;
-        block.nVersion        = nVersion;
-        block.hashPrevBlock   = hashPrev;
-        block.hashMerkleRoot  = hashMerkleRoot;
-        block.nTime           = nTime;
-        block.nBits           = nBits;
-        block.nNonce          = nNonce;
+        if (nStatus & BLOCK_HAVE_WORKHASH) return cacheWorkHash;
 
-        return block.GetWorkHash();
+        return GetUncachedHeader().GetWorkHash();
     }
 
     std::string ToString() const
@@ -416,6 +464,39 @@ public:
     }
 };
 
+/**
+ * Storage for CBlockIndex entries. Entries are carved out of large contiguous
+ * chunks rather than allocated one by one, so the block index stays compact
+ * in memory and can be built and torn down without a heap allocation per
+ * block. Returned pointers stay valid until Clear().
+ */
+class CBlockIndexArena
+{
+private:
+    //! Number of entries in a chunk allocated by Allocate() on its own.
+    static constexpr size_t CHUNK_ENTRIES = 4096;
+
+    std::vector<std::unique_ptr<CBlockIndex[]>> m_chunks;
+    size_t m_chunk_size{0};
+    size_t m_chunk_used{0};
+    size_t m_size{0};
+
+    void NewChunk(size_t entries);
+
+public:
+    /** Make sure the next count calls to Allocate() are served from a single chunk. */
+    void Reserve(size_t count);
+
+    /** Return a default-constructed entry. */
+    CBlockIndex* Allocate();
+
+    /** Destroy every entry returned so far. */
+    void Clear();
+
+    /** The number of entries returned so far. */
+    size_t Size() const { return m_size; }
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain {
 private:
@@ -21,7 +21,6 @@
 void GenesisGenerator(CBlock genesis) {
     printf("Searching for genesis block...\n");
 
-    uint256 hash;
     bool fNegative;
     bool fOverflow;
     arith_uint256 bnTarget;
@@ -29,14 +28,16 @@ void GenesisGenerator(CBlock genesis) {
 
     while(true)
     {
-        hash = genesis.GetWorkHash();
-        if (UintToArith256(hash) <= bnTarget)
-            break;
-        if ((genesis.nNonce & 0xFFF) == 0)
+        // Sweep up to the next multiple of 0x1000, reporting progress there.
+        const uint32_t count = 0x1000 - (genesis.nNonce & 0xFFF);
+        const std::optional<uint32_t> nonce = SweepNonces(genesis, bnTarget, genesis.nNonce, count);
+        if (nonce)
         {
-            printf("nonce %08X: hash = %s (target = %s)\n", genesis.nNonce, hash.ToString().c_str(), bnTarget.ToString().c_str());
+            genesis.nNonce = *nonce;
+            break;
         }
-        ++genesis.nNonce;
+        genesis.nNonce += count;
+        printf("nonce %08X: no hash at or below target %s\n", genesis.nNonce, bnTarget.ToString().c_str());
         if (genesis.nNonce == 0)
         {
             printf("NONCE WRAPPED, incrementing time\n");
@@ -50,20 +51,35 @@ void GenesisGenerator(CBlock genesis) {
     printf("block.MerkleRoot = %s \n", genesis.hashMerkleRoot.ToString().c_str());
 }
 
-static CBlock CreateGenesisBlock(const char* pszTimestamp, const CScript& genesisOutputScript, uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const CAmount& genesisReward, std::vector<SnapshotEntry>& vSnapshot)
+static CMutableTransaction CreateGenesisCoinbase(const char* pszTimestamp, const CScript& genesisOutputScript, const CAmount& genesisReward)
 {
     CMutableTransaction txNew;
     txNew.nVersion = 1;
     txNew.vin.resize(1);
-    txNew.vout.resize(vSnapshot.size() + 1);
+    txNew.vout.resize(1);
     txNew.vin[0].scriptSig = CScript() << 486604799 << CScriptNum(4) << std::vector<unsigned char>((const unsigned char*)pszTimestamp, (const unsigned char*)pszTimestamp + strlen(pszTimestamp));
     txNew.vout[0].nValue = genesisReward;
     txNew.vout[0].scriptPubKey = genesisOutputScript;
+    return txNew;
+}
 
-    for (unsigned int i = 0; i < vSnapshot.size(); ++i)
+/**
+ * Genesis coinbase before the snapshot coins, which the snapshot is checked against
+ */
+static CMutableTransaction CreateGenesisCoinbase(const char* pszTimestamp, const CAmount& genesisReward)
+{
+    const CScript genesisOutputScript = CScript() << ParseHex("04cb16c90fdcd962e9b78b2b09c78b76b67ea205cb93efa8772c2df2ab265cbc1b3bb4e6b16f77378b768d293de62e6d14a4b348c679060fa43a44bfa78a2f4411") << OP_CHECKSIG;
+    return CreateGenesisCoinbase(pszTimestamp, genesisOutputScript, genesisReward);
+}
+
+static CBlock CreateGenesisBlock(CMutableTransaction txNew, uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const SnapshotFile* snapshot)
+{
+    const size_t snapshot_size = snapshot ? snapshot->size() : 0;
+    txNew.vout.reserve(txNew.vout.size() + snapshot_size);
+    for (size_t i = 0; i < snapshot_size; ++i)
     {
-        txNew.vout[i + 1].nValue = vSnapshot[i].amount;
-        txNew.vout[i + 1].scriptPubKey = vSnapshot[i].script;
+        // Open() rejected any record with an unknown script type
+        txNew.vout.emplace_back(snapshot->GetAmount(i), *snapshot->GetScript(i));
     }
 
     CBlock genesis;
@@ -79,12 +95,38 @@ static CBlock CreateGenesisBlock(const char* pszTimestamp, const CScript& genesi
 }
 
 /**
- * Build the genesis block. It includes snapshot coins from vSnapshot
+ * Build the genesis block. It includes snapshot coins from the mapped snapshot, if any
  */
-static CBlock CreateGenesisBlock(uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const CAmount& genesisReward, const char* pszTimestamp, std::vector<SnapshotEntry> vSnapshot)
+static CBlock CreateGenesisBlock(uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const CAmount& genesisReward, const char* pszTimestamp, const SnapshotFile* snapshot)
 {
-    const CScript genesisOutputScript = CScript() << ParseHex("04cb16c90fdcd962e9b78b2b09c78b76b67ea205cb93efa8772c2df2ab265cbc1b3bb4e6b16f77378b768d293de62e6d14a4b348c679060fa43a44bfa78a2f4411") << OP_CHECKSIG;
-    return CreateGenesisBlock(pszTimestamp, genesisOutputScript, nTime, nNonce, nBits, nVersion, genesisReward, vSnapshot);
+    return CreateGenesisBlock(CreateGenesisCoinbase(pszTimestamp, genesisReward), nTime, nNonce, nBits, nVersion, snapshot);
+}
+
+/**
+ * Build the genesis header alone, with the merkle root pinned so the snapshot
+ * coinbase does not have to be built to know the genesis hashes.
+ */
+static CBlockHeader CreateGenesisHeader(uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const uint256& merkle_root)
+{
+    CBlockHeader header;
+    header.nTime    = nTime;
+    header.nBits    = nBits;
+    header.nNonce   = nNonce;
+    header.nVersion = nVersion;
+    header.hashPrevBlock.SetNull();
+    header.hashMerkleRoot = merkle_root;
+    return header;
+}
+
+const CBlock& CChainParams::GenesisBlock() const
+{
+    std::call_once(m_genesis_once, [this] {
+        genesis = genesis_builder();
+        assert(genesis.hashMerkleRoot == genesis_header.hashMerkleRoot);
+        assert(genesis.GetIndexHash() == consensus.hashGenesisBlock);
+        assert(consensus.hashGenesisBlockWork.IsNull() || genesis.GetWorkHash() == consensus.hashGenesisBlockWork);
+    });
+    return genesis;
 }
 
 /**
@@ -156,15 +198,17 @@ public:
             {"http://micro.codepillow.io", "/mainnet.csv"},
         };
 
-        vSnapshot = InitSnapshot("mainnet.csv", providers);
-
-        genesis = CreateGenesisBlock(1570625829, 709, 0x1f3fffff, 1, consensus.baseReward, pszTimestamp, vSnapshot);
-        consensus.hashGenesisBlock = genesis.GetIndexHash();
-        consensus.hashGenesisBlockWork = genesis.GetWorkHash();
+        genesis_header = CreateGenesisHeader(1570625829, 709, 0x1f3fffff, 1, uint256S("0x3426ccad3017e14a4ab6efddaa44cb31beca67a86c82f63de18705f1b6de88df"));
+        genesis_builder = [header = genesis_header, reward = consensus.baseReward, pszTimestamp, providers] {
+            const CMutableTransaction coinbase = CreateGenesisCoinbase(pszTimestamp, reward);
+            const auto snapshot = InitSnapshot("mainnet", providers, coinbase, header.hashMerkleRoot);
+            CBlock genesis = CreateGenesisBlock(coinbase, header.nTime, header.nNonce, header.nBits, header.nVersion, snapshot.get());
+            return genesis;
+        };
+        consensus.hashGenesisBlock = genesis_header.GetIndexHash();
+        consensus.hashGenesisBlockWork = uint256S("0x001cb6047ddf13074c4bce354ed3cf0cdd96a4287aa562b032eb81d03e183da8");
 
         assert(consensus.hashGenesisBlock == uint256S("0x14c03ecf20edc9887fb98bf34b53809f063fc491e73f588961f764fac88ecbae"));
-        assert(consensus.hashGenesisBlockWork == uint256S("0x001cb6047ddf13074c4bce354ed3cf0cdd96a4287aa562b032eb81d03e183da8"));
-        assert(genesis.hashMerkleRoot == uint256S("0x3426ccad3017e14a4ab6efddaa44cb31beca67a86c82f63de18705f1b6de88df"));
 
         base58Prefixes[PUBKEY_ADDRESS] = std::vector<unsigned char>(1,26);
         base58Prefixes[SCRIPT_ADDRESS] = std::vector<unsigned char>(1,51);
@@ -273,15 +317,15 @@ public:
 
         const char* pszTimestamp = "The WSJ 05/Oct/2019 Hong Kong Shuts Down After Night of Violence";
 
-        vSnapshot = EmptySnapshot();
-        genesis = CreateGenesisBlock(1634445073, 2131, 0x1f3fffff, 1, consensus.baseReward, pszTimestamp, vSnapshot);
-
-        consensus.hashGenesisBlock = genesis.GetIndexHash();
-        consensus.hashGenesisBlockWork = genesis.GetWorkHash();
+        genesis_header = CreateGenesisHeader(1634445073, 2131, 0x1f3fffff, 1, uint256S("0xeac469c73c951cbeab7f4cd074f3b280dbcf5027d53e04cc4f9cb50028e43af6"));
+        genesis_builder = [header = genesis_header, reward = consensus.baseReward, pszTimestamp] {
+            CBlock genesis = CreateGenesisBlock(header.nTime, header.nNonce, header.nBits, header.nVersion, reward, pszTimestamp, nullptr);
+            return genesis;
+        };
+        consensus.hashGenesisBlock = genesis_header.GetIndexHash();
+        consensus.hashGenesisBlockWork = uint256S("0x002ccba2978484648cc5b9ebd95a277fa2d26a56e29e787279e14452cc195fb5");
 
         assert(consensus.hashGenesisBlock == uint256S("0xd36a04fdef89fe61faf23f84ba930308130adb83a44a905de9c07c46c46d1a6d"));
-        assert(consensus.hashGenesisBlockWork == uint256S("0x002ccba2978484648cc5b9ebd95a277fa2d26a56e29e787279e14452cc195fb5"));
-        assert(genesis.hashMerkleRoot == uint256S("0xeac469c73c951cbeab7f4cd074f3b280dbcf5027d53e04cc4f9cb50028e43af6"));
 
         vFixedSeeds.clear();
         vSeeds.clear();
@@ -413,13 +457,15 @@ public:
         consensus.rewardEpochRate_v2 = 0.18;
 
         const char* pszTimestamp = "The WSJ 09/Oct/2019 Nobel Prize in Chemistry Awarded to Developers of Lithium-Ion Batteries";
-        vSnapshot = EmptySnapshot();
 
-        genesis = CreateGenesisBlock(1598918400, 1487, 0x1f3fffff, 1, consensus.baseReward, pszTimestamp, vSnapshot);
-        consensus.hashGenesisBlock = genesis.GetIndexHash();
+        genesis_header = CreateGenesisHeader(1598918400, 1487, 0x1f3fffff, 1, uint256S("0xd5322aa9dc80dda1982ba855afe7970bf246589a18f3c5920320849a813eb0fc"));
+        genesis_builder = [header = genesis_header, reward = consensus.baseReward, pszTimestamp] {
+            CBlock genesis = CreateGenesisBlock(header.nTime, header.nNonce, header.nBits, header.nVersion, reward, pszTimestamp, nullptr);
+            return genesis;
+        };
+        consensus.hashGenesisBlock = genesis_header.GetIndexHash();
 
         assert(consensus.hashGenesisBlock == uint256S("0x83468e58cd2bd0cb30f1b722c84db65029e0cd5718aabe6461294b33da809762"));
-        assert(genesis.hashMerkleRoot == uint256S("0xd5322aa9dc80dda1982ba855afe7970bf246589a18f3c5920320849a813eb0fc"));
 
         vFixedSeeds.clear();
 
@@ -501,13 +547,15 @@ public:
 
         const char* pszTimestamp = "Cretaceous Bird-Like Dinosaur Had Adaptations for Swimming and Diving | Sci-News Dec 2, 2022";
 
-        vSnapshot = EmptySnapshot();
 
-        genesis = CreateGenesisBlock(1670163306, 1, 0x207fffff, 1, consensus.baseReward, pszTimestamp, vSnapshot);
-        consensus.hashGenesisBlock = genesis.GetIndexHash();
+        genesis_header = CreateGenesisHeader(1670163306, 1, 0x207fffff, 1, uint256S("0x2c3057ab4ec6d1a7a89079100bcdb9d5e3b17815f878ec007d4c9609c599dbc7"));
+        genesis_builder = [header = genesis_header, reward = consensus.baseReward, pszTimestamp] {
+            CBlock genesis = CreateGenesisBlock(header.nTime, header.nNonce, header.nBits, header.nVersion, reward, pszTimestamp, nullptr);
+            return genesis;
+        };
+        consensus.hashGenesisBlock = genesis_header.GetIndexHash();
 
         assert(consensus.hashGenesisBlock == uint256S("0x809f50088e594b701c0c9a3377cb165255ad621ea2664ee41b164ca28a899722"));
-        assert(genesis.hashMerkleRoot == uint256S("0x2c3057ab4ec6d1a7a89079100bcdb9d5e3b17815f878ec007d4c9609c599dbc7"));
 
         vFixedSeeds.clear(); //!< Regtest mode doesn't have any fixed seeds.
         vSeeds.clear();      //!< Regtest mode doesn't have any DNS seeds.
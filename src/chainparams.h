@@ -12,9 +12,10 @@
 #include <primitives/block.h>
 #include <protocol.h>
 #include <util/hash_type.h>
-#include <snapshot.h>
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -93,7 +94,13 @@ public:
         return a.SetSpecial(addr) ? GetDefaultPort(a.GetNetwork()) : GetDefaultPort();
     }
 
-    const CBlock& GenesisBlock() const { return genesis; }
+    /**
+     * The full genesis block. It carries the whole genesis snapshot, so it is
+     * only built on first use and checked against the pinned hashes then.
+     */
+    const CBlock& GenesisBlock() const;
+    /** Genesis header, enough for anything that does not need the transactions */
+    const CBlockHeader& GenesisBlockHeader() const { return genesis_header; }
     /** Default value for -checkmempool and -checkblockindex argument */
     bool DefaultConsistencyChecks() const { return fDefaultConsistencyChecks; }
     /** Policy: Filter transactions that do not match well-defined patterns */
@@ -136,9 +143,11 @@ protected:
     std::vector<unsigned char> base58Prefixes[MAX_BASE58_TYPES];
     std::string bech32_hrp;
     std::string strNetworkID;
-    CBlock genesis;
+    CBlockHeader genesis_header;
+    std::function<CBlock()> genesis_builder;
+    mutable std::once_flag m_genesis_once;
+    mutable CBlock genesis;
     std::vector<uint8_t> vFixedSeeds;
-    std::vector<SnapshotEntry> vSnapshot;
     bool fDefaultConsistencyChecks;
     bool fRequireStandard;
     bool m_is_test_chain;
@@ -41,6 +41,14 @@
 #endif
 
 // Little-endian byte access.
+#ifdef NATIVE_LITTLE_ENDIAN
+static inline uint64_t B2B_GET64(const void *p)
+{
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+#else
 #define B2B_GET64(p)                            \
     (((uint64_t) ((uint8_t *) (p))[0]) ^        \
     (((uint64_t) ((uint8_t *) (p))[1]) << 8) ^  \
@@ -50,6 +58,7 @@
     (((uint64_t) ((uint8_t *) (p))[5]) << 40) ^ \
     (((uint64_t) ((uint8_t *) (p))[6]) << 48) ^ \
     (((uint64_t) ((uint8_t *) (p))[7]) << 56))
+#endif
 
 // G Mixing function.
 #define B2B_G(a, b, c, d, x, y) {   \
@@ -168,8 +177,9 @@ int blake2b_init(blake2b_ctx *ctx, size_t outlen,
 void blake2b_update(blake2b_ctx *ctx,
     const void *in, size_t inlen) // data bytes
 {
-    size_t i;
-    for (i = 0; i < inlen; i++) {
+    const uint8_t *data = (const uint8_t *) in;
+    while (inlen > 0) {
+        size_t n;
         if (ctx->c == 128) { // buffer full ?
             ctx->t[0] += ctx->c; // add counters
             if (ctx->t[0] < ctx->c) // carry overflow ?
@@ -177,7 +187,15 @@ void blake2b_update(blake2b_ctx *ctx,
             blake2b_compress(ctx, 0); // compress (not last)
             ctx->c = 0; // counter to zero
         }
-        ctx->b[ctx->c++] = ((const uint8_t *) in)[i];
+        // copy as much as fits into the buffer
+        n = 128 - ctx->c;
+        if (n > inlen) {
+            n = inlen;
+        }
+        memcpy(&ctx->b[ctx->c], data, n);
+        ctx->c += n;
+        data += n;
+        inlen -= n;
     }
 }
 
@@ -194,9 +212,8 @@ void blake2b_final(blake2b_ctx *ctx, void *out)
     }
 
     // fill up with zeros
-    while (ctx->c < 128) {
-        ctx->b[ctx->c++] = 0;
-    }
+    memset(&ctx->b[ctx->c], 0, 128 - ctx->c);
+    ctx->c = 128;
 
     blake2b_compress(ctx, 1); // final block flag = 1
 
@@ -37,6 +37,21 @@ void pbkdf2_blake2b(const uint8_t * passwd, size_t passwdlen, const uint8_t * sa
 
 #if defined(__cplusplus)
 }
+
+#include <string>
+
+/** Autodetect the best available multi-buffer BLAKE2b implementations.
+ *  Returns their names.
+ */
+std::string Blake2bAutoDetect();
+
+/** Compute the 32-byte BLAKE2b hashes of multiple 80-byte blobs, such as
+ *  block headers, several at a time with SIMD where available.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*80 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void Blake2b80(unsigned char* output, const unsigned char* input, size_t blocks);
 #endif
 
 #endif
@@ -0,0 +1,116 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX512
+
+#include <stdint.h>
+// GCC 12 warns that the unmasked AVX-512 intrinsics read an undefined vector,
+// which they leave undefined on purpose.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#include <crypto/common.h>
+
+namespace blake2b80_avx512 {
+namespace {
+
+constexpr uint64_t IV[8] = {
+    0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+    0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179
+};
+
+constexpr uint8_t SIGMA[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+__m512i inline K(uint64_t x) { return _mm512_set1_epi64(x); }
+
+__m512i inline Add(__m512i x, __m512i y) { return _mm512_add_epi64(x, y); }
+__m512i inline Xor(__m512i x, __m512i y) { return _mm512_xor_si512(x, y); }
+
+/** The BLAKE2b G function, on one message per 64-bit lane. */
+void inline __attribute__((always_inline)) G(__m512i& a, __m512i& b, __m512i& c, __m512i& d, __m512i x, __m512i y)
+{
+    a = Add(Add(a, b), x);
+    d = _mm512_ror_epi64(Xor(d, a), 32);
+    c = Add(c, d);
+    b = _mm512_ror_epi64(Xor(b, c), 24);
+    a = Add(Add(a, b), y);
+    d = _mm512_ror_epi64(Xor(d, a), 16);
+    c = Add(c, d);
+    b = _mm512_ror_epi64(Xor(b, c), 63);
+}
+
+/** Word i of eight consecutive 80-byte messages. */
+__m512i inline Read8(const unsigned char* in, int i)
+{
+    const __m512i offsets = _mm512_setr_epi64(0, 80, 160, 240, 320, 400, 480, 560);
+    return _mm512_i64gather_epi64(offsets, in + 8 * i, 1);
+}
+
+/** Store word i of eight consecutive 32-byte digests. */
+void inline Write8(unsigned char* out, int i, __m512i v)
+{
+    alignas(64) uint64_t words[8];
+    _mm512_store_si512(words, v);
+    for (int j = 0; j < 8; ++j) {
+        WriteLE64(out + 32 * j + 8 * i, words[j]);
+    }
+}
+
+} // namespace
+
+void Hash_8way(unsigned char* out, const unsigned char* in)
+{
+    // An 80-byte message is a single, final block padded with zeros.
+    __m512i m[16];
+    for (int i = 0; i < 10; ++i) m[i] = Read8(in, i);
+    for (int i = 10; i < 16; ++i) m[i] = _mm512_setzero_si512();
+
+    // Parameter block: 32-byte digest, no key, fanout and depth 1.
+    const uint64_t h0 = IV[0] ^ 0x01010020;
+    __m512i v[16] = {
+        K(h0), K(IV[1]), K(IV[2]), K(IV[3]), K(IV[4]), K(IV[5]), K(IV[6]), K(IV[7]),
+        K(IV[0]), K(IV[1]), K(IV[2]), K(IV[3]), K(IV[4] ^ 80), K(IV[5]), K(~IV[6]), K(IV[7]),
+    };
+
+#pragma GCC unroll 12
+    for (int r = 0; r < 12; ++r) {
+        G(v[0], v[4], v[8], v[12], m[SIGMA[r][0]], m[SIGMA[r][1]]);
+        G(v[1], v[5], v[9], v[13], m[SIGMA[r][2]], m[SIGMA[r][3]]);
+        G(v[2], v[6], v[10], v[14], m[SIGMA[r][4]], m[SIGMA[r][5]]);
+        G(v[3], v[7], v[11], v[15], m[SIGMA[r][6]], m[SIGMA[r][7]]);
+        G(v[0], v[5], v[10], v[15], m[SIGMA[r][8]], m[SIGMA[r][9]]);
+        G(v[1], v[6], v[11], v[12], m[SIGMA[r][10]], m[SIGMA[r][11]]);
+        G(v[2], v[7], v[8], v[13], m[SIGMA[r][12]], m[SIGMA[r][13]]);
+        G(v[3], v[4], v[9], v[14], m[SIGMA[r][14]], m[SIGMA[r][15]]);
+    }
+
+    Write8(out, 0, Xor(K(h0), Xor(v[0], v[8])));
+    Write8(out, 1, Xor(K(IV[1]), Xor(v[1], v[9])));
+    Write8(out, 2, Xor(K(IV[2]), Xor(v[2], v[10])));
+    Write8(out, 3, Xor(K(IV[3]), Xor(v[3], v[11])));
+}
+
+}
+
+#endif
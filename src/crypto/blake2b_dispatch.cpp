@@ -0,0 +1,147 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/blake2b.h>
+
+#include <compat/cpuid.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <string>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+namespace blake2b80_avx2
+{
+void Hash_4way(unsigned char* out, const unsigned char* in);
+}
+
+namespace blake2b80_avx512
+{
+void Hash_8way(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+namespace {
+
+typedef void (*Hash80Type)(unsigned char*, const unsigned char*);
+
+void Hash80(unsigned char* out, const unsigned char* in)
+{
+    blake2b_hash(out, in, 80);
+}
+
+Hash80Type Hash80_4way = nullptr;
+Hash80Type Hash80_8way = nullptr;
+
+/** Compare every multi-buffer implementation in use against blake2b_hash(). */
+bool SelfTest()
+{
+    // 8 different 80-byte messages, not aligned.
+    unsigned char in[1 + 8 * 80];
+    for (size_t i = 0; i < sizeof(in); ++i) {
+        in[i] = i * 0x9d + (i >> 3);
+    }
+    unsigned char expected[8 * 32];
+    for (int i = 0; i < 8; ++i) {
+        Hash80(expected + 32 * i, in + 1 + 80 * i);
+    }
+
+    // The hash of the empty string, to check blake2b_hash() itself.
+    static const unsigned char empty[32] = {
+        0x0e, 0x57, 0x51, 0xc0, 0x26, 0xe5, 0x43, 0xb2, 0xe8, 0xab, 0x2e, 0xb0, 0x60, 0x99, 0xda, 0xa1,
+        0xd1, 0xe5, 0xdf, 0x47, 0x77, 0x8f, 0x77, 0x87, 0xfa, 0xab, 0x45, 0xcd, 0xf1, 0x2f, 0xe3, 0xa8,
+    };
+    unsigned char out[8 * 32];
+    blake2b_hash(out, in, 0);
+    if (memcmp(out, empty, 32) != 0) return false;
+
+    if (Hash80_4way) {
+        Hash80_4way(out, in + 1);
+        Hash80_4way(out + 128, in + 1 + 320);
+        if (memcmp(out, expected, sizeof(out)) != 0) return false;
+    }
+    if (Hash80_8way) {
+        Hash80_8way(out, in + 1);
+        if (memcmp(out, expected, sizeof(out)) != 0) return false;
+    }
+    return true;
+}
+
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+/** Whether the OS saves the register state enabled by the given XCR0 mask. */
+bool XCR0Enabled(uint32_t mask)
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & mask) == mask;
+}
+#endif
+
+} // namespace
+
+std::string Blake2bAutoDetect()
+{
+    std::string ret = "standard";
+    Hash80_4way = nullptr;
+    Hash80_8way = nullptr;
+
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && XCR0Enabled(0x6);
+    bool have_avx2 = false;
+    bool have_avx512 = false;
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    if (have_avx && eax >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = have_avx2 && ((ebx >> 16) & 1) && ((ebx >> 31) & 1) && XCR0Enabled(0xe6);
+    }
+    (void)have_avx2;
+    (void)have_avx512;
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_MICRO_INTERNAL)
+    if (have_avx2) {
+        Hash80_4way = blake2b80_avx2::Hash_4way;
+        ret += ",avx2(4way)";
+    }
+#endif
+#if defined(ENABLE_AVX512) && !defined(BUILD_MICRO_INTERNAL)
+    if (have_avx512) {
+        Hash80_8way = blake2b80_avx512::Hash_8way;
+        ret += ",avx512(8way)";
+    }
+#endif
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+void Blake2b80(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (Hash80_8way) {
+        while (blocks >= 8) {
+            Hash80_8way(out, in);
+            out += 256;
+            in += 640;
+            blocks -= 8;
+        }
+    }
+    if (Hash80_4way) {
+        while (blocks >= 4) {
+            Hash80_4way(out, in);
+            out += 128;
+            in += 320;
+            blocks -= 4;
+        }
+    }
+    while (blocks) {
+        Hash80(out, in);
+        out += 32;
+        in += 80;
+        --blocks;
+    }
+}
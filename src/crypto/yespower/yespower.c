@@ -84,6 +84,8 @@
 #include <emmintrin.h>
 #ifdef __XOP__
 #include <x86intrin.h>
+#elif defined(__AVX512VL__)
+#include <immintrin.h>
 #endif
 #elif defined(__SSE__)
 #include <xmmintrin.h>
@@ -98,6 +100,20 @@
 #include <crypto/utils/sysendian.h>
 #include <crypto/blake2b.h>
 
+/*
+ * This file is built once per instruction set (see yespower_dispatch.cpp).
+ * Each build names its entry points through YESPOWER_VARIANT so that they
+ * can be linked side by side and picked at runtime.
+ */
+#ifdef YESPOWER_VARIANT
+#define yespower YESPOWER_VARIANT(yespower)
+#define yespower_init_local YESPOWER_VARIANT(yespower_init_local)
+#define yespower_free_local YESPOWER_VARIANT(yespower_free_local)
+#define yespower_lanes YESPOWER_VARIANT(yespower_lanes)
+#define yespower_batch YESPOWER_VARIANT(yespower_batch)
+#define yespower_local_size YESPOWER_VARIANT(yespower_local_size)
+#endif
+
 #include "yespower.h"
 
 #ifdef __unix__
@@ -262,6 +278,9 @@ static inline void salsa20_simd_unshuffle(const salsa20_blk_t *Bin,
 #ifdef __XOP__
 #define ARX(out, in1, in2, s) \
     out = _mm_xor_si128(out, _mm_roti_epi32(_mm_add_epi32(in1, in2), s));
+#elif defined(__AVX512VL__)
+#define ARX(out, in1, in2, s) \
+    out = _mm_xor_si128(out, _mm_rol_epi32(_mm_add_epi32(in1, in2), s));
 #else
 #define ARX(out, in1, in2, s) { \
     __m128i tmp = _mm_add_epi32(in1, in2); \
@@ -1104,6 +1123,489 @@ static void smix(uint8_t *B, size_t r, uint32_t N,
 #include "yespower.c"
 #undef smix
 
+/*
+ * Number of inputs yespower_batch() interleaves on one thread.  With 2 lanes
+ * the state of both fits in the 16 vector registers, and their S-boxes and
+ * V blocks in L2.  4 lanes (with the 32 registers of AVX-512VL) were no
+ * faster than 2, as the lanes then compete for L2.
+ */
+#ifdef __SSE2__
+#define YESPOWER_LANES 2
+#else
+#define YESPOWER_LANES 1
+#endif
+
+#ifdef __SSE2__
+/*
+ * Interleaved yespower 1.0 kernel.  Up to YESPOWER_MAX_LANES independent
+ * inputs ("lanes") are processed in lockstep on one thread: each lane has its
+ * own B, V, XY and S-boxes, and every step below is issued for all lanes
+ * before the next one, so that the pwxform and Salsa20 dependency chains of
+ * the lanes overlap.  The control flow and the write pointer w do not depend
+ * on the data, so they are shared; the V and S-box indices are per lane.
+ *
+ * The functions are always inlined into callers with a constant number of
+ * lanes, which lets the compiler unroll the lane loops and keep the lane
+ * state in registers.
+ */
+#ifdef __GNUC__
+#define LANES_INLINE static inline __attribute__((always_inline))
+#define FOR_EACH_LANE(l) \
+    _Pragma("GCC unroll 2") for ((l) = 0; (l) < lanes; (l)++)
+#else
+#define LANES_INLINE static inline
+#define FOR_EACH_LANE(l) \
+    for ((l) = 0; (l) < lanes; (l)++)
+#endif
+
+#define DECL_X_LANES \
+    __m128i X0[YESPOWER_MAX_LANES], X1[YESPOWER_MAX_LANES]; \
+    __m128i X2[YESPOWER_MAX_LANES], X3[YESPOWER_MAX_LANES]; \
+    size_t l;
+
+#define DECL_S_LANES \
+    uint8_t *S0[YESPOWER_MAX_LANES], *S1[YESPOWER_MAX_LANES]; \
+    uint8_t *S2[YESPOWER_MAX_LANES]; \
+    size_t w = ctx[0].w; \
+    FOR_EACH_LANE(l) { \
+        S0[l] = ctx[l].S0; S1[l] = ctx[l].S1; S2[l] = ctx[l].S2; \
+    }
+
+#define SAVE_S_LANES \
+    FOR_EACH_LANE(l) { \
+        ctx[l].S0 = S0[l]; ctx[l].S1 = S1[l]; ctx[l].S2 = S2[l]; \
+        ctx[l].w = w; \
+    }
+
+#define READ_X_LANES(in) \
+    FOR_EACH_LANE(l) { \
+        X0[l] = (in).q[0]; X1[l] = (in).q[1]; \
+        X2[l] = (in).q[2]; X3[l] = (in).q[3]; \
+    }
+
+#define WRITE_X_LANES(out) \
+    FOR_EACH_LANE(l) { \
+        (out).q[0] = X0[l]; (out).q[1] = X1[l]; \
+        (out).q[2] = X2[l]; (out).q[3] = X3[l]; \
+    }
+
+#define XOR_X_LANES(in) \
+    FOR_EACH_LANE(l) { \
+        X0[l] = _mm_xor_si128(X0[l], (in).q[0]); \
+        X1[l] = _mm_xor_si128(X1[l], (in).q[1]); \
+        X2[l] = _mm_xor_si128(X2[l], (in).q[2]); \
+        X3[l] = _mm_xor_si128(X3[l], (in).q[3]); \
+    }
+
+#define XOR_X_2_LANES(in1, in2) \
+    FOR_EACH_LANE(l) { \
+        X0[l] = _mm_xor_si128((in1).q[0], (in2).q[0]); \
+        X1[l] = _mm_xor_si128((in1).q[1], (in2).q[1]); \
+        X2[l] = _mm_xor_si128((in1).q[2], (in2).q[2]); \
+        X3[l] = _mm_xor_si128((in1).q[3], (in2).q[3]); \
+    }
+
+#define XOR_X_WRITE_XOR_Y_2_LANES(out, in) \
+    FOR_EACH_LANE(l) { \
+        __m128i Y0, Y1, Y2, Y3; \
+        (out).q[0] = Y0 = _mm_xor_si128((out).q[0], (in).q[0]); \
+        (out).q[1] = Y1 = _mm_xor_si128((out).q[1], (in).q[1]); \
+        (out).q[2] = Y2 = _mm_xor_si128((out).q[2], (in).q[2]); \
+        (out).q[3] = Y3 = _mm_xor_si128((out).q[3], (in).q[3]); \
+        X0[l] = _mm_xor_si128(X0[l], Y0); \
+        X1[l] = _mm_xor_si128(X1[l], Y1); \
+        X2[l] = _mm_xor_si128(X2[l], Y2); \
+        X3[l] = _mm_xor_si128(X3[l], Y3); \
+    }
+
+#define INTEGERIFY_LANE(l) (uint32_t)_mm_cvtsi128_si32(X0[l])
+
+#define ARX_LANES(out, in1, in2, s) \
+    FOR_EACH_LANE(l) ARX(out[l], in1[l], in2[l], s)
+
+#define SHUFFLE_LANES(X, s) \
+    FOR_EACH_LANE(l) X[l] = _mm_shuffle_epi32(X[l], s);
+
+#define SALSA20_2ROUNDS_LANES \
+    /* Operate on "columns" */ \
+    ARX_LANES(X1, X0, X3, 7) \
+    ARX_LANES(X2, X1, X0, 9) \
+    ARX_LANES(X3, X2, X1, 13) \
+    ARX_LANES(X0, X3, X2, 18) \
+    /* Rearrange data */ \
+    SHUFFLE_LANES(X1, 0x93) \
+    SHUFFLE_LANES(X2, 0x4E) \
+    SHUFFLE_LANES(X3, 0x39) \
+    /* Operate on "rows" */ \
+    ARX_LANES(X3, X0, X1, 7) \
+    ARX_LANES(X2, X3, X0, 9) \
+    ARX_LANES(X1, X2, X3, 13) \
+    ARX_LANES(X0, X1, X2, 18) \
+    /* Rearrange data */ \
+    SHUFFLE_LANES(X1, 0x39) \
+    SHUFFLE_LANES(X2, 0x4E) \
+    SHUFFLE_LANES(X3, 0x93)
+
+/**
+ * Apply the Salsa20/2 core to the blocks provided in X of every lane.
+ */
+#define SALSA20_2_LANES(out) { \
+    __m128i Z0[YESPOWER_MAX_LANES], Z1[YESPOWER_MAX_LANES]; \
+    __m128i Z2[YESPOWER_MAX_LANES], Z3[YESPOWER_MAX_LANES]; \
+    FOR_EACH_LANE(l) { \
+        Z0[l] = X0[l]; Z1[l] = X1[l]; Z2[l] = X2[l]; Z3[l] = X3[l]; \
+    } \
+    SALSA20_2ROUNDS_LANES \
+    FOR_EACH_LANE(l) { \
+        (out).q[0] = X0[l] = _mm_add_epi32(X0[l], Z0[l]); \
+        (out).q[1] = X1[l] = _mm_add_epi32(X1[l], Z1[l]); \
+        (out).q[2] = X2[l] = _mm_add_epi32(X2[l], Z2[l]); \
+        (out).q[3] = X3[l] = _mm_add_epi32(X3[l], Z3[l]); \
+    } \
+}
+
+#define PWXFORM_SIMD_LANES(X) \
+    FOR_EACH_LANE(l) { \
+        uint64_t x = EXTRACT64(X[l]) & Smask2; \
+        __m128i s0 = *(__m128i *)(S0[l] + (uint32_t)x); \
+        __m128i s1 = *(__m128i *)(S1[l] + (x >> 32)); \
+        X[l] = _mm_mul_epu32(HI32(X[l]), X[l]); \
+        X[l] = _mm_add_epi64(X[l], s0); \
+        X[l] = _mm_xor_si128(X[l], s1); \
+    }
+
+#define PWXFORM_SIMD_WRITE_LANES(X, Sw) \
+    PWXFORM_SIMD_LANES(X) \
+    FOR_EACH_LANE(l) *(__m128i *)(Sw[l] + w) = X[l];
+
+#define PWXFORM_ROUND_WRITE4_LANES \
+    PWXFORM_SIMD_WRITE_LANES(X0, S0) \
+    PWXFORM_SIMD_WRITE_LANES(X1, S1) \
+    w += 16; \
+    PWXFORM_SIMD_WRITE_LANES(X2, S0) \
+    PWXFORM_SIMD_WRITE_LANES(X3, S1) \
+    w += 16;
+
+#define PWXFORM_ROUND_WRITE2_LANES \
+    PWXFORM_SIMD_WRITE_LANES(X0, S0) \
+    PWXFORM_SIMD_WRITE_LANES(X1, S1) \
+    w += 16; \
+    PWXFORM_SIMD_LANES(X2) \
+    PWXFORM_SIMD_LANES(X3)
+
+#define PWXFORM_LANES \
+    PWXFORM_ROUND_WRITE4_LANES \
+    PWXFORM_ROUND_WRITE2_LANES \
+    PWXFORM_ROUND_WRITE2_LANES \
+    w &= Smask2; \
+    FOR_EACH_LANE(l) { \
+        uint8_t *Stmp = S2[l]; \
+        S2[l] = S1[l]; \
+        S1[l] = S0[l]; \
+        S0[l] = Stmp; \
+    }
+
+/**
+ * blockmix_lanes(Bin, Bout, r, ctx, lanes):
+ * blockmix_1_0() of every lane.
+ */
+LANES_INLINE void blockmix_lanes(salsa20_blk_t *const *Bin,
+    salsa20_blk_t *const *Bout, size_t r, pwxform_ctx_t *ctx,
+    const size_t lanes)
+{
+    size_t i;
+    DECL_X_LANES
+    DECL_S_LANES
+
+    /* Convert count of 128-byte blocks to max index of 64-byte block */
+    r = r * 2 - 1;
+
+    READ_X_LANES(Bin[l][r])
+
+    i = 0;
+    do {
+        XOR_X_LANES(Bin[l][i])
+        PWXFORM_LANES
+        if (unlikely(i >= r))
+            break;
+        WRITE_X_LANES(Bout[l][i])
+        i++;
+    } while (1);
+
+    SAVE_S_LANES
+
+    SALSA20_2_LANES(Bout[l][i])
+}
+
+/**
+ * blockmix_xor_lanes(Bin1, Bin2, Bout, r, ctx, lanes, j):
+ * blockmix_xor_1_0() of every lane, with the results in j.
+ */
+LANES_INLINE void blockmix_xor_lanes(salsa20_blk_t *const *Bin1,
+    salsa20_blk_t *const *Bin2, salsa20_blk_t *const *Bout,
+    size_t r, pwxform_ctx_t *ctx, const size_t lanes, uint32_t *j)
+{
+    size_t i;
+    DECL_X_LANES
+    DECL_S_LANES
+
+    /* Convert count of 128-byte blocks to max index of 64-byte block */
+    r = r * 2 - 1;
+
+#ifdef PREFETCH
+    FOR_EACH_LANE(l) {
+        PREFETCH(&Bin2[l][r], _MM_HINT_T0)
+        for (i = 0; i < r; i++) {
+            PREFETCH(&Bin2[l][i], _MM_HINT_T0)
+        }
+    }
+#endif
+
+    XOR_X_2_LANES(Bin1[l][r], Bin2[l][r])
+
+    i = 0;
+    r--;
+    do {
+        XOR_X_LANES(Bin1[l][i])
+        XOR_X_LANES(Bin2[l][i])
+        PWXFORM_LANES
+        WRITE_X_LANES(Bout[l][i])
+
+        XOR_X_LANES(Bin1[l][i + 1])
+        XOR_X_LANES(Bin2[l][i + 1])
+        PWXFORM_LANES
+
+        if (unlikely(i >= r))
+            break;
+
+        WRITE_X_LANES(Bout[l][i + 1])
+
+        i += 2;
+    } while (1);
+    i++;
+
+    SAVE_S_LANES
+
+    SALSA20_2_LANES(Bout[l][i])
+
+    FOR_EACH_LANE(l)
+        j[l] = INTEGERIFY_LANE(l);
+}
+
+/**
+ * blockmix_xor_save_lanes(Bin1out, Bin2, r, ctx, lanes, j):
+ * blockmix_xor_save_1_0() of every lane, with the results in j.
+ */
+LANES_INLINE void blockmix_xor_save_lanes(salsa20_blk_t *const *Bin1out,
+    salsa20_blk_t *const *Bin2, size_t r, pwxform_ctx_t *ctx,
+    const size_t lanes, uint32_t *j)
+{
+    size_t i;
+    DECL_X_LANES
+    DECL_S_LANES
+
+    /* Convert count of 128-byte blocks to max index of 64-byte block */
+    r = r * 2 - 1;
+
+#ifdef PREFETCH
+    FOR_EACH_LANE(l) {
+        PREFETCH(&Bin2[l][r], _MM_HINT_T0)
+        for (i = 0; i < r; i++) {
+            PREFETCH(&Bin2[l][i], _MM_HINT_T0)
+        }
+    }
+#endif
+
+    XOR_X_2_LANES(Bin1out[l][r], Bin2[l][r])
+
+    i = 0;
+    r--;
+    do {
+        XOR_X_WRITE_XOR_Y_2_LANES(Bin2[l][i], Bin1out[l][i])
+        PWXFORM_LANES
+        WRITE_X_LANES(Bin1out[l][i])
+
+        XOR_X_WRITE_XOR_Y_2_LANES(Bin2[l][i + 1], Bin1out[l][i + 1])
+        PWXFORM_LANES
+
+        if (unlikely(i >= r))
+            break;
+
+        WRITE_X_LANES(Bin1out[l][i + 1])
+
+        i += 2;
+    } while (1);
+    i++;
+
+    SAVE_S_LANES
+
+    SALSA20_2_LANES(Bin1out[l][i])
+
+    FOR_EACH_LANE(l)
+        j[l] = INTEGERIFY_LANE(l);
+}
+
+/**
+ * smix1_lanes(B, r, N, V, XY, ctx, lanes):
+ * smix1_1_0() of every lane.
+ */
+LANES_INLINE void smix1_lanes(uint8_t *const *B, size_t r, uint32_t N,
+    salsa20_blk_t *const *V, salsa20_blk_t *const *XY, pwxform_ctx_t *ctx,
+    const size_t lanes)
+{
+    size_t s = 2 * r;
+    salsa20_blk_t *X[YESPOWER_MAX_LANES], *Y[YESPOWER_MAX_LANES];
+    salsa20_blk_t *V_j[YESPOWER_MAX_LANES];
+    uint32_t i, j[YESPOWER_MAX_LANES], n;
+    size_t l;
+
+    FOR_EACH_LANE(l) {
+        X[l] = V[l];
+        Y[l] = &V[l][s];
+        for (i = 0; i < 2; i++) {
+            const salsa20_blk_t *src = (salsa20_blk_t *)&B[l][i * 64];
+            salsa20_blk_t *tmp = Y[l];
+            salsa20_blk_t *dst = &X[l][i];
+            size_t k;
+            for (k = 0; k < 16; k++)
+                tmp->w[k] = le32dec(&src->w[k]);
+            salsa20_simd_shuffle(tmp, dst);
+        }
+    }
+
+    for (i = 1; i < r; i++) {
+        salsa20_blk_t *Bin[YESPOWER_MAX_LANES], *Bout[YESPOWER_MAX_LANES];
+        FOR_EACH_LANE(l) {
+            Bin[l] = &X[l][(i - 1) * 2];
+            Bout[l] = &X[l][i * 2];
+        }
+        blockmix_lanes(Bin, Bout, 1, ctx, lanes);
+    }
+
+    blockmix_lanes(X, Y, r, ctx, lanes);
+    FOR_EACH_LANE(l)
+        X[l] = Y[l] + s;
+    blockmix_lanes(Y, X, r, ctx, lanes);
+    FOR_EACH_LANE(l)
+        j[l] = integerify(X[l], r);
+
+    for (n = 2; n < N; n <<= 1) {
+        uint32_t m = (n < N / 2) ? n : (N - 1 - n);
+        for (i = 1; i < m; i += 2) {
+            FOR_EACH_LANE(l) {
+                Y[l] = X[l] + s;
+                j[l] &= n - 1;
+                j[l] += i - 1;
+                V_j[l] = &V[l][j[l] * s];
+            }
+            blockmix_xor_lanes(X, V_j, Y, r, ctx, lanes, j);
+            FOR_EACH_LANE(l) {
+                j[l] &= n - 1;
+                j[l] += i;
+                V_j[l] = &V[l][j[l] * s];
+                X[l] = Y[l] + s;
+            }
+            blockmix_xor_lanes(Y, V_j, X, r, ctx, lanes, j);
+        }
+    }
+    n >>= 1;
+
+    FOR_EACH_LANE(l) {
+        j[l] &= n - 1;
+        j[l] += N - 2 - n;
+        V_j[l] = &V[l][j[l] * s];
+        Y[l] = X[l] + s;
+    }
+    blockmix_xor_lanes(X, V_j, Y, r, ctx, lanes, j);
+    FOR_EACH_LANE(l) {
+        j[l] &= n - 1;
+        j[l] += N - 1 - n;
+        V_j[l] = &V[l][j[l] * s];
+    }
+    blockmix_xor_lanes(Y, V_j, XY, r, ctx, lanes, j);
+
+    FOR_EACH_LANE(l) {
+        for (i = 0; i < 2 * r; i++) {
+            const salsa20_blk_t *src = &XY[l][i];
+            salsa20_blk_t *tmp = &XY[l][s];
+            salsa20_blk_t *dst = (salsa20_blk_t *)&B[l][i * 64];
+            size_t k;
+            for (k = 0; k < 16; k++)
+                le32enc(&tmp->w[k], src->w[k]);
+            salsa20_simd_unshuffle(tmp, dst);
+        }
+    }
+}
+
+/**
+ * smix2_lanes(B, r, N, Nloop, V, XY, ctx, lanes):
+ * smix2_1_0() of every lane.
+ */
+LANES_INLINE void smix2_lanes(uint8_t *const *B, size_t r, uint32_t N,
+    uint32_t Nloop, salsa20_blk_t *const *V, salsa20_blk_t *const *XY,
+    pwxform_ctx_t *ctx, const size_t lanes)
+{
+    size_t s = 2 * r;
+    salsa20_blk_t *X[YESPOWER_MAX_LANES], *Y[YESPOWER_MAX_LANES];
+    salsa20_blk_t *V_j[YESPOWER_MAX_LANES];
+    uint32_t i, j[YESPOWER_MAX_LANES];
+    size_t l;
+
+    FOR_EACH_LANE(l) {
+        X[l] = XY[l];
+        Y[l] = &XY[l][s];
+        for (i = 0; i < 2 * r; i++) {
+            const salsa20_blk_t *src = (salsa20_blk_t *)&B[l][i * 64];
+            salsa20_blk_t *tmp = Y[l];
+            salsa20_blk_t *dst = &X[l][i];
+            size_t k;
+            for (k = 0; k < 16; k++)
+                tmp->w[k] = le32dec(&src->w[k]);
+            salsa20_simd_shuffle(tmp, dst);
+        }
+        j[l] = integerify(X[l], r) & (N - 1);
+    }
+
+    do {
+        FOR_EACH_LANE(l)
+            V_j[l] = &V[l][j[l] * s];
+        blockmix_xor_save_lanes(X, V_j, r, ctx, lanes, j);
+        FOR_EACH_LANE(l) {
+            j[l] &= N - 1;
+            V_j[l] = &V[l][j[l] * s];
+        }
+        blockmix_xor_save_lanes(X, V_j, r, ctx, lanes, j);
+        FOR_EACH_LANE(l)
+            j[l] &= N - 1;
+    } while (Nloop -= 2);
+
+    FOR_EACH_LANE(l) {
+        for (i = 0; i < 2 * r; i++) {
+            const salsa20_blk_t *src = &X[l][i];
+            salsa20_blk_t *tmp = Y[l];
+            salsa20_blk_t *dst = (salsa20_blk_t *)&B[l][i * 64];
+            size_t k;
+            for (k = 0; k < 16; k++)
+                le32enc(&tmp->w[k], src->w[k]);
+            salsa20_simd_unshuffle(tmp, dst);
+        }
+    }
+}
+#endif /* __SSE2__ */
+
+/**
+ * yespower_local_size(params):
+ * Return the size of the memory allocation yespower() needs in local for
+ * params: B, V and XY followed by the pwxform S-boxes.
+ */
+size_t yespower_local_size(const yespower_params_t *params)
+{
+    size_t B_size = (size_t)128 * params->r;
+
+    return B_size + B_size * params->N + B_size + 64 +
+        3 * Swidth_to_Sbytes1(Swidth_1_0);
+}
+
 /**
  * yespower(local, src, srclen, params, dst):
  * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
@@ -1144,7 +1646,7 @@ int yespower(yespower_local_t *local,
     Swidth = Swidth_1_0;
     ctx.Sbytes = 3 * Swidth_to_Sbytes1(Swidth);
 
-    need = B_size + V_size + XY_size + ctx.Sbytes;
+    need = yespower_local_size(params);
     if (local->aligned_size < need) {
         if (free_region(local))
             goto fail;
@@ -1183,25 +1685,140 @@ fail:
     return -1;
 }
 
+#ifdef __SSE2__
 /**
- * yespower_tls(src, srclen, params, dst):
- * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
- * The memory allocation is maintained internally using thread-local storage.
+ * yespower_lanes_hash(local, src, srclen, params, dst, lanes):
+ * Compute yespower() of the inputs src[i * srclen .. (i + 1) * srclen - 1]
+ * for i from 0 to lanes - 1 into dst[i], with local[i] as the thread-local
+ * data structure of input i.  Only the yespower 1.0 SMix is interleaved;
+ * the S-boxes are filled by each lane on its own.
  *
  * Return 0 on success; or -1 on error.
  */
-int yespower_tls(const uint8_t *src, size_t srclen,
-    const yespower_params_t *params, yespower_binary_t *dst)
+LANES_INLINE int yespower_lanes_hash(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params,
+    yespower_binary_t *dst, const size_t lanes)
 {
-    static __thread int initialized = 0;
-    static __thread yespower_local_t local;
+    uint32_t N = params->N;
+    uint32_t r = params->r;
+    const uint8_t *pers = params->pers;
+    size_t perslen = params->perslen;
+    uint32_t Swidth, Nloop_rw;
+    size_t B_size, V_size, XY_size, need, l;
+    uint8_t *B[YESPOWER_MAX_LANES];
+    salsa20_blk_t *V[YESPOWER_MAX_LANES], *XY[YESPOWER_MAX_LANES];
+    pwxform_ctx_t ctx[YESPOWER_MAX_LANES];
+    uint8_t init_hash[YESPOWER_MAX_LANES][32];
+
+    /* Sanity-check parameters */
+    if ((N < 1024 || N > 512 * 1024 || r < 8 || r > 32 ||
+        (N & (N - 1)) != 0 ||
+        (!pers && perslen))) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    /* Allocate memory */
+    B_size = (size_t)128 * r;
+    V_size = B_size * N;
+
+    XY_size = B_size + 64;
+    Swidth = Swidth_1_0;
+
+    need = yespower_local_size(params);
+    for (l = 0; l < lanes; l++) {
+        const uint8_t *salt = pers ? pers : src + l * srclen;
+        uint8_t *S;
+
+        if (local[l].aligned_size < need) {
+            if (free_region(&local[l]))
+                goto fail;
+            if (!alloc_region(&local[l], need))
+                goto fail;
+        }
+        B[l] = (uint8_t *)local[l].aligned;
+        V[l] = (salsa20_blk_t *)((uint8_t *)B[l] + B_size);
+        XY[l] = (salsa20_blk_t *)((uint8_t *)V[l] + V_size);
+        S = (uint8_t *)XY[l] + XY_size;
+        ctx[l].Sbytes = 3 * Swidth_to_Sbytes1(Swidth);
+        ctx[l].S0 = S;
+        ctx[l].S1 = S + Swidth_to_Sbytes1(Swidth);
+        ctx[l].S2 = S + 2 * Swidth_to_Sbytes1(Swidth);
+        ctx[l].w = 0;
+
+        blake2b_hash(init_hash[l], src + l * srclen, srclen);
+        pbkdf2_blake2b(init_hash[l], sizeof(init_hash[l]),
+            salt, pers ? perslen : 0, 1, B[l], 128);
+        memcpy(init_hash[l], B[l], sizeof(init_hash[l]));
+        smix1_1_0(B[l], 1, ctx[l].Sbytes / 128,
+            (salsa20_blk_t *)ctx[l].S0, XY[l], NULL);
+    }
 
-    if (!initialized) {
-        init_region(&local);
-        initialized = 1;
+    /* The rest of smix_1_0() */
+    Nloop_rw = (N + 2) / 3; /* 1/3, round up */
+    Nloop_rw++; Nloop_rw &= ~(uint32_t)1; /* round up to even */
+    smix1_lanes(B, r, N, V, XY, ctx, lanes);
+    smix2_lanes(B, r, N, Nloop_rw, V, XY, ctx, lanes);
+
+    for (l = 0; l < lanes; l++) {
+        hmac_blake2b_hash((uint8_t *)&dst[l], B[l] + B_size - 64, 64,
+            init_hash[l], sizeof(init_hash[l]));
+    }
+
+    /* Success! */
+    return 0;
+
+fail:
+    memset(dst, 0xff, lanes * sizeof(*dst));
+    return -1;
+}
+
+static int yespower_2way(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params,
+    yespower_binary_t *dst)
+{
+    return yespower_lanes_hash(local, src, srclen, params, dst, 2);
+}
+#endif /* __SSE2__ */
+
+int yespower_lanes(void)
+{
+    return YESPOWER_LANES;
+}
+
+/**
+ * yespower_batch(local, src, srclen, params, dst, n):
+ * Compute yespower() of n inputs of srclen bytes each, YESPOWER_LANES of
+ * them at a time.
+ *
+ * Return 0 on success; or -1 on error.
+ */
+int yespower_batch(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params,
+    yespower_binary_t *dst, size_t n)
+{
+    int retval = 0;
+
+    while (n > 0) {
+        size_t lanes = 1;
+#if YESPOWER_LANES >= 2
+        if (n >= 2) {
+            lanes = 2;
+            retval |= yespower_2way(local, src, srclen, params, dst);
+        } else
+#endif
+        {
+            retval |= yespower(local, src, srclen, params, dst);
+        }
+        src += lanes * srclen;
+        dst += lanes;
+        n -= lanes;
     }
 
-    return yespower(&local, src, srclen, params, dst);
+    return retval;
 }
 
 int yespower_init_local(yespower_local_t *local)
@@ -89,6 +89,13 @@ extern int yespower_init_local(yespower_local_t *local);
  */
 extern int yespower_free_local(yespower_local_t *local);
 
+/**
+ * yespower_local_size(params):
+ * Return the number of bytes yespower() allocates in a thread-local data
+ * structure for params.
+ */
+extern size_t yespower_local_size(const yespower_params_t *params);
+
 /**
  * yespower(local, src, srclen, params, dst):
  * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
@@ -108,7 +115,8 @@ extern int yespower(yespower_local_t *local,
 /**
  * yespower_tls(src, srclen, params, dst):
  * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
- * The memory allocation is maintained internally using thread-local storage.
+ * The memory allocation is a scratchpad borrowed from the ones shared by all
+ * threads for the duration of the call (see YespowerScratchpadsSetup()).
  *
  * Return 0 on success; or -1 on error.
  *
@@ -117,8 +125,98 @@ extern int yespower(yespower_local_t *local,
 extern int yespower_tls(const uint8_t *src, size_t srclen,
     const yespower_params_t *params, yespower_binary_t *dst);
 
+/**
+ * The largest number of inputs any implementation interleaves in
+ * yespower_batch().
+ */
+#define YESPOWER_MAX_LANES 2
+
+/**
+ * yespower_lanes():
+ * Return the number of inputs yespower_batch() interleaves on one thread,
+ * which is 1 if it only hashes them one after another.
+ */
+extern int yespower_lanes(void);
+
+/**
+ * yespower_batch(local, src, srclen, params, dst, n):
+ * Compute yespower() of the n inputs src[i * srclen .. (i + 1) * srclen - 1]
+ * into dst[i].  Up to yespower_lanes() of them are processed together, with
+ * their instructions interleaved to make use of the otherwise idle execution
+ * units and memory bandwidth.  The results are the same as from yespower().
+ *
+ * Return 0 on success; or -1 on error.
+ *
+ * local must point to yespower_lanes() thread-local data structures, each
+ * initialized with yespower_init_local().
+ *
+ * MT-safe as long as local and dst are local to the thread.
+ */
+extern int yespower_batch(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params, yespower_binary_t *dst, size_t n);
+
+/**
+ * yespower_tls_batch(src, srclen, params, dst, n):
+ * Compute yespower_batch() of n inputs, with the memory allocations of a
+ * borrowed scratchpad, as in yespower_tls().
+ *
+ * Return 0 on success; or -1 on error.
+ *
+ * MT-safe as long as dst is local to the thread.
+ */
+extern int yespower_tls_batch(const uint8_t *src, size_t srclen,
+    const yespower_params_t *params, yespower_binary_t *dst, size_t n);
+
 #ifdef __cplusplus
 }
+
+#include <string>
+
+/**
+ * Select the yespower implementation behind the functions above: the one
+ * named by impl ("generic", "avx512" or "xop"), or for "auto" the
+ * preferred one this CPU supports. The implementation must pass a self-test
+ * first. Returns its name, or an empty string if the requested one is not
+ * available, in which case the generic implementation is used.
+ */
+std::string YespowerAutoDetect(const std::string& impl = "auto");
+
+/** Memory statistics of the scratchpads behind yespower_tls(). */
+struct YespowerScratchpadStats {
+    size_t max;            //!< Most scratchpads there may be, 0 for no limit
+    size_t total;          //!< Scratchpads allocated
+    size_t in_use;         //!< Scratchpads a thread is hashing with
+    size_t bytes;          //!< Bytes mapped for all scratchpads
+    size_t hugetlb_bytes;  //!< Of which on explicitly reserved huge pages
+    size_t thp_bytes;      //!< Of which advised to use transparent huge pages
+    size_t numa_nodes;     //!< NUMA nodes the scratchpads are on
+    uint64_t temporary;    //!< Times a thread hashed in a temporary scratchpad, all being in use
+    uint64_t remote;       //!< Times a thread borrowed a scratchpad on another NUMA node
+    uint64_t waits;        //!< Times a thread waited for a scratchpad, all being in use
+};
+
+/**
+ * Configure the scratchpads yespower_tls() and yespower_tls_batch() borrow
+ * for the duration of a call. There are at most max of them (0 for no
+ * limit). A scratchpad is allocated by the first thread to borrow it, so
+ * that its pages are on that thread's NUMA node. Threads borrow one on their
+ * own node first, then allocate one while under max, then borrow one on
+ * another node as it is. When all max are in use, a thread waits briefly for
+ * one to be returned, then hashes in one of a few temporary scratchpads that
+ * are freed afterwards, or else waits until either is available. With
+ * hugepages, scratchpads are mapped on explicitly reserved huge pages where
+ * there are enough of them, and are advised to use transparent huge pages
+ * otherwise.
+ *
+ * Frees the scratchpads not in use, then allocates prealloc of them (at
+ * most max), spread over the NUMA nodes, each with room for
+ * yespower_lanes() inputs with params. Returns false if that allocation
+ * failed.
+ */
+bool YespowerScratchpadsSetup(size_t max, bool hugepages, size_t prealloc = 0, const yespower_params_t* params = nullptr);
+
+YespowerScratchpadStats YespowerScratchpadsStats();
 #endif
 
 #endif /* !_YESPOWER_H_ */
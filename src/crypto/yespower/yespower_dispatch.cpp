@@ -0,0 +1,219 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/common.h>
+#include <crypto/yespower/yespower.h>
+
+#include <compat/cpuid.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+int yespower_generic(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst);
+int yespower_lanes_generic(void);
+int yespower_batch_generic(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst, size_t n);
+int yespower_init_local_generic(yespower_local_t* local);
+int yespower_free_local_generic(yespower_local_t* local);
+size_t yespower_local_size_generic(const yespower_params_t* params);
+#if defined(ENABLE_AVX512) && !defined(BUILD_MICRO_INTERNAL)
+int yespower_avx512(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst);
+int yespower_lanes_avx512(void);
+int yespower_batch_avx512(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst, size_t n);
+#endif
+#if defined(ENABLE_XOP) && !defined(BUILD_MICRO_INTERNAL)
+int yespower_xop(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst);
+int yespower_lanes_xop(void);
+int yespower_batch_xop(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst, size_t n);
+#endif
+}
+
+namespace {
+
+typedef int (*YespowerFn)(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst);
+typedef int (*YespowerLanesFn)(void);
+typedef int (*YespowerBatchFn)(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst, size_t n);
+
+struct YespowerImpl {
+    const char* name;
+    YespowerFn hash;
+    YespowerLanesFn lanes;
+    YespowerBatchFn batch;
+};
+
+YespowerFn Yespower = yespower_generic;
+YespowerLanesFn YespowerLanes = yespower_lanes_generic;
+YespowerBatchFn YespowerBatch = yespower_batch_generic;
+
+/**
+ * Check the work hash of the mainnet genesis header, which pins the consensus
+ * parameters too, and that batches of headers hash the same as single ones.
+ */
+bool SelfTest(const YespowerImpl& impl)
+{
+    static const yespower_params_t params = {
+        2048,
+        32,
+        (const uint8_t*)"Now I am become Death, the destroyer of worlds",
+        46
+    };
+    static const unsigned char header[80] = {
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0xdf, 0x88, 0xde, 0xb6, 0xf1, 0x05, 0x87, 0xe1, 0x3d, 0xf6, 0x82, 0x6c,
+        0xa8, 0x67, 0xca, 0xbe, 0x31, 0xcb, 0x44, 0xaa, 0xdd, 0xef, 0xb6, 0x4a, 0x4a, 0xe1, 0x17, 0x30,
+        0xad, 0xcc, 0x26, 0x34, 0x25, 0xd9, 0x9d, 0x5d, 0xff, 0xff, 0x3f, 0x1f, 0xc5, 0x02, 0x00, 0x00,
+    };
+    static const unsigned char expected[32] = {
+        0xa8, 0x3d, 0x18, 0x3e, 0xd0, 0x81, 0xeb, 0x32, 0xb0, 0x62, 0xa5, 0x7a, 0x28, 0xa4, 0x96, 0xdd,
+        0x0c, 0xcf, 0xd3, 0x4e, 0x35, 0xce, 0x4b, 0x4c, 0x07, 0x13, 0xdf, 0x7d, 0x04, 0xb6, 0x1c, 0x00,
+    };
+
+    yespower_local_t local[YESPOWER_MAX_LANES];
+    for (yespower_local_t& l : local) yespower_init_local_generic(&l);
+    auto free_local = [&] { for (yespower_local_t& l : local) yespower_free_local_generic(&l); };
+
+    yespower_binary_t out;
+    if (impl.hash(local, header, sizeof(header), &params, &out) != 0 || memcmp(out.uc, expected, sizeof(expected)) != 0) {
+        free_local();
+        return false;
+    }
+
+    // The interleaved lanes of a batch must not mix up their inputs: hash
+    // the header with lanes + 1 different nonces, one by one and as a batch.
+    assert(impl.lanes() <= YESPOWER_MAX_LANES);
+    const int count = impl.lanes() + 1;
+    std::vector<unsigned char> batch;
+    std::vector<yespower_binary_t> batch_out(count), single_out(count);
+    for (int i = 0; i < count; ++i) {
+        batch.insert(batch.end(), header, header + sizeof(header));
+        batch[i * sizeof(header) + 76] ^= i;
+        if (impl.hash(local, &batch[i * sizeof(header)], sizeof(header), &params, &single_out[i]) != 0) {
+            free_local();
+            return false;
+        }
+    }
+    const int ret = impl.batch(local, batch.data(), sizeof(header), &params, batch_out.data(), count);
+    free_local();
+    return ret == 0 && memcmp(batch_out.data(), single_out.data(), count * sizeof(yespower_binary_t)) == 0;
+}
+
+/** Self-test results by implementation name, as every test hashes several headers. */
+std::mutex g_self_tests_mutex;
+std::map<std::string, bool> g_self_tests;
+
+bool SelfTestOnce(const YespowerImpl& impl)
+{
+    std::lock_guard<std::mutex> lock(g_self_tests_mutex);
+    auto it = g_self_tests.find(impl.name);
+    if (it == g_self_tests.end()) {
+        it = g_self_tests.emplace(impl.name, SelfTest(impl)).first;
+    }
+    return it->second;
+}
+
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+/** Whether the OS saves the register state enabled by the given XCR0 mask. */
+bool XCR0Enabled(uint32_t mask)
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & mask) == mask;
+}
+#endif
+
+} // namespace
+
+std::string YespowerAutoDetect(const std::string& impl)
+{
+    const YespowerImpl generic{"generic", yespower_generic, yespower_lanes_generic, yespower_batch_generic};
+    // Candidates in order of preference. XOP and AVX-512VL have a vector
+    // rotate, which shortens the Salsa20 dependency chains. Wider vectors
+    // alone do not help, as pwxform works on 128-bit lanes, so there is no
+    // AVX2 variant.
+    std::vector<YespowerImpl> candidates;
+
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && XCR0Enabled(0x6);
+    bool have_avx512 = false;
+    bool have_xop = false;
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    if (have_avx && eax >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        const bool have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = have_avx2 && ((ebx >> 16) & 1) && ((ebx >> 31) & 1) && XCR0Enabled(0xe6);
+    }
+    GetCPUID(0x80000000, 0, eax, ebx, ecx, edx);
+    if (have_avx && eax >= 0x80000001) {
+        GetCPUID(0x80000001, 0, eax, ebx, ecx, edx);
+        have_xop = (ecx >> 11) & 1;
+    }
+    (void)have_avx512;
+    (void)have_xop;
+
+#if defined(ENABLE_XOP) && !defined(BUILD_MICRO_INTERNAL)
+    if (have_xop) candidates.push_back({"xop", yespower_xop, yespower_lanes_xop, yespower_batch_xop});
+#endif
+#if defined(ENABLE_AVX512) && !defined(BUILD_MICRO_INTERNAL)
+    if (have_avx512) candidates.push_back({"avx512", yespower_avx512, yespower_lanes_avx512, yespower_batch_avx512});
+#endif
+#endif
+    candidates.push_back(generic);
+
+    for (const YespowerImpl& candidate : candidates) {
+        if (impl != "auto" && impl != candidate.name) continue;
+        if (!SelfTestOnce(candidate)) continue;
+        Yespower = candidate.hash;
+        YespowerLanes = candidate.lanes;
+        YespowerBatch = candidate.batch;
+        return candidate.name;
+    }
+
+    // The requested implementation is unknown, unsupported by this CPU or
+    // failed its self-test: fall back to the portable one.
+    assert(SelfTestOnce(generic));
+    Yespower = generic.hash;
+    YespowerLanes = generic.lanes;
+    YespowerBatch = generic.batch;
+    return "";
+}
+
+extern "C" {
+int yespower(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst)
+{
+    return Yespower(local, src, srclen, params, dst);
+}
+
+int yespower_lanes(void)
+{
+    return YespowerLanes();
+}
+
+int yespower_batch(yespower_local_t* local, const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst, size_t n)
+{
+    return YespowerBatch(local, src, srclen, params, dst, n);
+}
+
+int yespower_init_local(yespower_local_t* local)
+{
+    return yespower_init_local_generic(local);
+}
+
+int yespower_free_local(yespower_local_t* local)
+{
+    return yespower_free_local_generic(local);
+}
+
+size_t yespower_local_size(const yespower_params_t* params)
+{
+    return yespower_local_size_generic(params);
+}
+}
@@ -0,0 +1,8 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/* Portable build of yespower: SSE2 on x86-64, plain C elsewhere. */
+
+#define YESPOWER_VARIANT(name) name##_generic
+#include "yespower.c"
@@ -0,0 +1,474 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/yespower/yespower.h>
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Map scratchpads the way yespower.c maps its own regions, as it unmaps them
+// itself when it has to grow one.
+#ifdef __unix__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+/** Size of the huge pages scratchpads are aligned to. */
+constexpr size_t HUGEPAGE_SIZE = 2 * 1024 * 1024;
+
+/** What a region of a scratchpad is mapped on. */
+enum class Backing {
+    PAGES,   //!< Regular pages, or allocated by yespower() itself
+    THP,     //!< Regular pages advised to be merged into transparent huge pages
+    HUGETLB, //!< Explicitly reserved huge pages
+};
+
+/** The NUMA node of the CPU the calling thread runs on. */
+int CurrentNode()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned int cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return node;
+#endif
+    return 0;
+}
+
+/**
+ * The CPUs of each NUMA node, as listed in sysfs. Empty where that is not
+ * available, which is treated as a single node.
+ */
+std::map<int, std::vector<int>> NodeCpus()
+{
+    std::map<int, std::vector<int>> nodes;
+#ifdef __linux__
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (!dir) return nodes;
+    while (const struct dirent* entry = readdir(dir)) {
+        int node;
+        char tail;
+        if (sscanf(entry->d_name, "node%d%c", &node, &tail) != 1) continue;
+        const std::string path = std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist";
+        FILE* file = fopen(path.c_str(), "r");
+        if (!file) continue;
+        // A list of ranges, such as "0-3,8-11".
+        std::vector<int> cpus;
+        int first, last;
+        while (fscanf(file, "%d", &first) == 1) {
+            last = first;
+            if (fscanf(file, "-%d", &last) < 0) last = first;
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) cpus.push_back(cpu);
+            if (fgetc(file) != ',') break;
+        }
+        fclose(file);
+        if (!cpus.empty()) nodes[node] = std::move(cpus);
+    }
+    closedir(dir);
+#endif
+    return nodes;
+}
+
+/**
+ * Run func on a thread restricted to cpus, so that the memory it faults in
+ * lands on their node. Runs it on an unrestricted thread if that fails.
+ */
+std::thread ThreadOnCpus(const std::vector<int>& cpus, std::function<void()> func)
+{
+    return std::thread([cpus, func = std::move(func)] {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+#endif
+        func();
+    });
+}
+
+/**
+ * Map size bytes for region, on huge pages if asked for and available, and
+ * fault them in on the calling thread so that the kernel puts them on its
+ * NUMA node. Leaves region empty, for yespower() to allocate itself, where
+ * regions cannot be mapped or if mapping fails.
+ */
+Backing AllocRegion(yespower_region_t& region, size_t size, bool hugepages)
+{
+    yespower_init_local(&region);
+#ifdef MAP_ANON
+#if defined(MAP_HUGETLB) && defined(MAP_POPULATE)
+    if (hugepages) {
+        // Round up to whole huge pages, as munmap() fails on MAP_HUGETLB
+        // mappings of any other size.
+        const size_t hugetlb_size = (size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+        void* base = mmap(nullptr, hugetlb_size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (base != MAP_FAILED) {
+            region.base = region.aligned = base;
+            region.base_size = hugetlb_size;
+            region.aligned_size = size;
+            return Backing::HUGETLB;
+        }
+    }
+#endif
+    // Map an extra huge page to trim to a huge page boundary, so that every
+    // whole huge page of the region can be a transparent one.
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t mapped_size = (size + page_size - 1) / page_size * page_size;
+    void* mapped = mmap(nullptr, mapped_size + HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (mapped == MAP_FAILED) return Backing::PAGES;
+    uint8_t* const base = static_cast<uint8_t*>(mapped);
+    uint8_t* const aligned = base + ((HUGEPAGE_SIZE - (uintptr_t)base % HUGEPAGE_SIZE) % HUGEPAGE_SIZE);
+    if (aligned > base) munmap(base, aligned - base);
+    if (aligned + mapped_size < base + mapped_size + HUGEPAGE_SIZE) {
+        munmap(aligned + mapped_size, base + mapped_size + HUGEPAGE_SIZE - (aligned + mapped_size));
+    }
+    Backing backing = Backing::PAGES;
+#ifdef MADV_HUGEPAGE
+    if (hugepages && madvise(aligned, mapped_size, MADV_HUGEPAGE) == 0) backing = Backing::THP;
+#endif
+    volatile uint8_t* const touch = aligned;
+    for (size_t i = 0; i < mapped_size; i += page_size) touch[i] = 0;
+    region.base = region.aligned = aligned;
+    region.base_size = mapped_size;
+    region.aligned_size = size;
+    return backing;
+#else
+    (void)size;
+    (void)hugepages;
+    return Backing::PAGES;
+#endif
+}
+
+/** The yespower locals of up to YESPOWER_MAX_LANES inputs, which one thread hashes with at a time. */
+struct Scratchpad {
+    yespower_local_t locals[YESPOWER_MAX_LANES];
+    Backing backing[YESPOWER_MAX_LANES];
+    /** Where each region was allocated, to notice yespower() growing it. */
+    void* allocated[YESPOWER_MAX_LANES];
+    /** NUMA node the regions were allocated on. */
+    const int node;
+    /** Allocated because all scratchpads were in use, freed when returned. */
+    const bool temporary;
+
+    /** What the regions add to YespowerScratchpadStats, updated under the pool lock when the scratchpad is returned. */
+    size_t bytes{0};
+    size_t hugetlb_bytes{0};
+    size_t thp_bytes{0};
+
+    Scratchpad(int node_in, bool temporary_in = false) : node(node_in), temporary(temporary_in)
+    {
+        for (int l = 0; l < YESPOWER_MAX_LANES; ++l) {
+            yespower_init_local(&locals[l]);
+            backing[l] = Backing::PAGES;
+            allocated[l] = nullptr;
+        }
+    }
+
+    ~Scratchpad() { Free(); }
+
+    Scratchpad(const Scratchpad&) = delete;
+    Scratchpad& operator=(const Scratchpad&) = delete;
+
+    void Free()
+    {
+        for (int l = 0; l < YESPOWER_MAX_LANES; ++l) {
+            yespower_free_local(&locals[l]);
+            backing[l] = Backing::PAGES;
+            allocated[l] = nullptr;
+        }
+    }
+
+    /** Make sure the first lanes regions have room for size bytes. */
+    void Prepare(size_t lanes, size_t size, bool hugepages)
+    {
+        for (size_t l = 0; l < lanes; ++l) {
+            if (locals[l].aligned_size >= size) continue;
+            yespower_free_local(&locals[l]);
+            backing[l] = AllocRegion(locals[l], size, hugepages);
+            allocated[l] = locals[l].aligned;
+        }
+    }
+
+    /** Bring the accounting up to date with the regions. */
+    void Account()
+    {
+        bytes = hugetlb_bytes = thp_bytes = 0;
+        for (int l = 0; l < YESPOWER_MAX_LANES; ++l) {
+            if (locals[l].aligned != allocated[l]) {
+                // yespower() had to grow the region and mapped it itself.
+                backing[l] = Backing::PAGES;
+                allocated[l] = locals[l].aligned;
+            }
+            bytes += locals[l].base_size;
+            if (backing[l] == Backing::HUGETLB) hugetlb_bytes += locals[l].base_size;
+            if (backing[l] == Backing::THP) thp_bytes += locals[l].base_size;
+        }
+    }
+};
+
+class ScratchpadPool
+{
+private:
+    /** Most temporary scratchpads there may be at a time. */
+    static constexpr size_t MAX_TEMPORARIES = 4;
+    /** How long a thread waits for a scratchpad to be returned before it allocates a temporary one. */
+    static constexpr std::chrono::milliseconds TEMPORARY_WAIT{20};
+
+    std::mutex m_mutex;
+    std::condition_variable m_returned;
+    std::vector<std::unique_ptr<Scratchpad>> m_scratchpads;
+    /** Scratchpads not in use per NUMA node, the most recently returned last. */
+    std::map<int, std::vector<Scratchpad*>> m_free;
+    size_t m_free_count{0};
+    /** Of m_scratchpads, the temporary ones. */
+    size_t m_temporaries{0};
+    size_t m_max{0};
+    bool m_hugepages{true};
+    uint64_t m_temporary_uses{0};
+    uint64_t m_remote_uses{0};
+    uint64_t m_waits{0};
+
+    void Destroy(Scratchpad* scratchpad)
+    {
+        m_scratchpads.erase(std::find_if(m_scratchpads.begin(), m_scratchpads.end(), [&](const std::unique_ptr<Scratchpad>& p) { return p.get() == scratchpad; }));
+    }
+
+    Scratchpad* TakeFree(std::vector<Scratchpad*>& free)
+    {
+        Scratchpad* scratchpad = free.back();
+        free.pop_back();
+        --m_free_count;
+        return scratchpad;
+    }
+
+    bool Full() const { return m_max != 0 && m_scratchpads.size() - m_temporaries >= m_max; }
+
+public:
+    /**
+     * Borrow a scratchpad with room for lanes inputs of size bytes each,
+     * preferring the most recently returned one on the calling thread's NUMA
+     * node, whose pages are the likeliest to still be cached. Once there may
+     * be no more scratchpads, one from another node is borrowed as it is,
+     * remote memory being cheaper than mapping it again. If all are in use,
+     * wait a little for one to be returned, then hash in one of at most
+     * MAX_TEMPORARIES temporary ones, or else wait for whichever comes first.
+     */
+    Scratchpad* Acquire(size_t lanes, size_t size)
+    {
+        const int node = CurrentNode();
+        Scratchpad* scratchpad = nullptr;
+        bool hugepages;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            bool waited = false;
+            bool may_use_temporary = false;
+            while (true) {
+                auto local = m_free.find(node);
+                if (local != m_free.end() && !local->second.empty()) {
+                    scratchpad = TakeFree(local->second);
+                    break;
+                }
+                if (!Full()) {
+                    m_scratchpads.push_back(std::make_unique<Scratchpad>(node));
+                    scratchpad = m_scratchpads.back().get();
+                    break;
+                }
+                if (m_free_count > 0) {
+                    // Take from the node with the most to spare.
+                    auto remote = std::max_element(m_free.begin(), m_free.end(), [](const auto& a, const auto& b) { return a.second.size() < b.second.size(); });
+                    scratchpad = TakeFree(remote->second);
+                    ++m_remote_uses;
+                    break;
+                }
+                if (may_use_temporary && m_temporaries < MAX_TEMPORARIES) {
+                    m_scratchpads.push_back(std::make_unique<Scratchpad>(node, /*temporary=*/true));
+                    scratchpad = m_scratchpads.back().get();
+                    ++m_temporaries;
+                    ++m_temporary_uses;
+                    break;
+                }
+                if (!waited) {
+                    ++m_waits;
+                    waited = true;
+                }
+                if (may_use_temporary) {
+                    m_returned.wait(lock);
+                } else {
+                    may_use_temporary = m_returned.wait_for(lock, TEMPORARY_WAIT) == std::cv_status::timeout;
+                }
+            }
+            hugepages = m_hugepages;
+        }
+        scratchpad->Prepare(lanes, size, hugepages);
+        return scratchpad;
+    }
+
+    void Release(Scratchpad* scratchpad)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            scratchpad->Account();
+            if (scratchpad->temporary) {
+                --m_temporaries;
+                Destroy(scratchpad);
+            } else if (m_max != 0 && m_scratchpads.size() - m_temporaries > m_max) {
+                Destroy(scratchpad);
+            } else {
+                m_free[scratchpad->node].push_back(scratchpad);
+                ++m_free_count;
+            }
+        }
+        m_returned.notify_one();
+    }
+
+    bool Setup(size_t max, bool hugepages, size_t prealloc, const yespower_params_t* params)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_max = max;
+        m_hugepages = hugepages;
+        for (const auto& [node, free] : m_free) {
+            for (Scratchpad* scratchpad : free) Destroy(scratchpad);
+        }
+        m_free.clear();
+        m_free_count = 0;
+        // Waiting threads may now allocate a scratchpad of their own.
+        m_returned.notify_all();
+        const size_t pooled = m_scratchpads.size() - m_temporaries;
+        if (max != 0) prealloc = std::min(prealloc, max - std::min(max, pooled));
+        if (prealloc == 0) return true;
+
+        // Spread the scratchpads over the NUMA nodes, each allocated by a
+        // thread running on its node. Without a node list, allocate them all
+        // on the calling thread.
+        std::map<int, std::vector<int>> nodes = NodeCpus();
+        if (nodes.size() <= 1) nodes = {{CurrentNode(), {}}};
+        std::map<int, std::vector<Scratchpad*>> allocated;
+        auto next = nodes.begin();
+        for (size_t i = 0; i < prealloc; ++i) {
+            m_scratchpads.push_back(std::make_unique<Scratchpad>(next->first));
+            allocated[next->first].push_back(m_scratchpads.back().get());
+            if (++next == nodes.end()) next = nodes.begin();
+        }
+        lock.unlock();
+
+        const size_t lanes = yespower_lanes();
+        const size_t size = yespower_local_size(params);
+        auto prepare = [&](const std::vector<Scratchpad*>& scratchpads) {
+            for (Scratchpad* scratchpad : scratchpads) scratchpad->Prepare(lanes, size, hugepages);
+        };
+        if (nodes.size() == 1) {
+            prepare(allocated.begin()->second);
+        } else {
+            std::vector<std::thread> threads;
+            for (const auto& [node, scratchpads] : allocated) {
+                threads.push_back(ThreadOnCpus(nodes[node], [&prepare, &scratchpads = scratchpads] { prepare(scratchpads); }));
+            }
+            for (std::thread& thread : threads) thread.join();
+        }
+
+        bool ret = true;
+        lock.lock();
+        for (const auto& [node, scratchpads] : allocated) {
+            for (Scratchpad* scratchpad : scratchpads) {
+                for (size_t l = 0; l < lanes; ++l) {
+                    if (!scratchpad->locals[l].aligned) ret = false;
+                }
+                scratchpad->Account();
+            }
+            std::vector<Scratchpad*>& free = m_free[node];
+            free.insert(free.end(), scratchpads.begin(), scratchpads.end());
+            m_free_count += scratchpads.size();
+        }
+        return ret;
+    }
+
+    YespowerScratchpadStats Stats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        YespowerScratchpadStats stats{};
+        stats.max = m_max;
+        stats.total = m_scratchpads.size();
+        stats.in_use = m_scratchpads.size() - m_free_count;
+        std::set<int> nodes;
+        for (const std::unique_ptr<Scratchpad>& scratchpad : m_scratchpads) {
+            stats.bytes += scratchpad->bytes;
+            stats.hugetlb_bytes += scratchpad->hugetlb_bytes;
+            stats.thp_bytes += scratchpad->thp_bytes;
+            if (scratchpad->bytes) nodes.insert(scratchpad->node);
+        }
+        stats.numa_nodes = nodes.size();
+        stats.temporary = m_temporary_uses;
+        stats.remote = m_remote_uses;
+        stats.waits = m_waits;
+        return stats;
+    }
+};
+
+ScratchpadPool& Pool()
+{
+    static ScratchpadPool pool;
+    return pool;
+}
+
+/** RAII borrowing of a scratchpad. */
+class ScratchpadLease
+{
+private:
+    Scratchpad* m_scratchpad;
+
+public:
+    ScratchpadLease(size_t lanes, const yespower_params_t* params)
+        : m_scratchpad(Pool().Acquire(lanes, yespower_local_size(params))) {}
+    ~ScratchpadLease() { Pool().Release(m_scratchpad); }
+
+    ScratchpadLease(const ScratchpadLease&) = delete;
+    ScratchpadLease& operator=(const ScratchpadLease&) = delete;
+
+    yespower_local_t* Locals() const { return m_scratchpad->locals; }
+};
+
+} // namespace
+
+bool YespowerScratchpadsSetup(size_t max, bool hugepages, size_t prealloc, const yespower_params_t* params)
+{
+    assert(prealloc == 0 || params);
+    return Pool().Setup(max, hugepages, prealloc, params);
+}
+
+YespowerScratchpadStats YespowerScratchpadsStats()
+{
+    return Pool().Stats();
+}
+
+extern "C" {
+int yespower_tls(const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst)
+{
+    ScratchpadLease lease(1, params);
+    return yespower(lease.Locals(), src, srclen, params, dst);
+}
+
+int yespower_tls_batch(const uint8_t* src, size_t srclen, const yespower_params_t* params, yespower_binary_t* dst, size_t n)
+{
+    ScratchpadLease lease(std::min<size_t>(yespower_lanes(), n), params);
+    return yespower_batch(lease.Locals(), src, srclen, params, dst, n);
+}
+}
@@ -0,0 +1,8 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/* yespower built with XOP enabled, which gives Salsa20 a native vector rotate. */
+
+#define YESPOWER_VARIANT(name) name##_xop
+#include "yespower.c"
@@ -7,6 +7,7 @@
 #define MICRO_HASH_H
 
 #include <attributes.h>
+#include <crypto/blake2b.h>
 #include <crypto/common.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha256.h>
@@ -24,10 +25,6 @@
 #define UEND(a)             ((unsigned char*)&((&(a))[1]))
 #define ARRAYLEN(array)     (sizeof(array)/sizeof((array)[0]))
 
-extern "C" {
-#include <crypto/blake2b.h>
-} // "C"
-
 typedef uint256 ChainCode;
 
 /** A hasher class for MicroBitcoin's 256-bit hash (double SHA-256). */
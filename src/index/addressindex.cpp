@@ -0,0 +1,631 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <index/addressindex.h>
+#include <node/blockstorage.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <txdb.h>
+#include <undo.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
+#include <tuple>
+
+constexpr uint8_t DB_ADDRESSINDEX{'a'};
+constexpr uint8_t DB_ADDRESSUNSPENTINDEX{'u'};
+constexpr uint8_t DB_TIMESTAMPINDEX{'S'};
+constexpr uint8_t DB_BLOCKHASHINDEX{'z'};
+constexpr uint8_t DB_SPENTINDEX{'p'};
+constexpr uint8_t DB_ADDRESSBALANCE{'w'};
+constexpr uint8_t DB_APPLIED_TIP{'T'};
+
+std::unique_ptr<AddressIndex> g_address_index;
+
+/** Access to the address index database (indexes/addressindex/) */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Write or erase balance changes and fold them into the balance records.
+    void UpdateAddressIndex(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect, bool fErase) const;
+    void UpdateAddressUnspentIndex(CDBBatch& batch, const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vect) const;
+    void UpdateSpentIndex(CDBBatch& batch, const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& vect) const;
+
+    bool ScanAddressIndex(const uint256& addressHash, int type, int start, int end, const CAddressIndexKey* from,
+                          const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                          std::optional<CAddressIndexKey>& next);
+    bool MergeAddressIndex(const std::vector<std::pair<uint256, int> >& addresses, int start, int end, const CAddressIndexKey* from,
+                           const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                           std::optional<CAddressIndexKey>& next);
+    bool ReadAddressUnspentIndex(const uint256& addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vect);
+
+    /// Drop the timestamp index older versions kept here; getblockhashes
+    /// searches the block index in memory instead.
+    bool EraseTimestampIndex();
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+/*
+ * The balance changes of one transaction are contiguous in a block, so each
+ * transaction is counted once per address.
+ */
+void AddressIndex::DB::UpdateAddressIndex(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect, bool fErase) const
+{
+    std::map<std::pair<unsigned int, uint256>, std::pair<CAddressBalanceValue, uint256> > balances;
+    const int sign = fErase ? -1 : 1;
+    for (const auto& [key, amount] : vect) {
+        if (fErase) {
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, key));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, key), amount);
+        }
+
+        auto it = balances.find(std::make_pair(key.type, key.hashBytes));
+        if (it == balances.end()) {
+            CAddressBalanceValue value;
+            Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(key.type, key.hashBytes)), value);
+            it = balances.emplace(std::make_pair(key.type, key.hashBytes), std::make_pair(value, uint256())).first;
+        }
+        CAddressBalanceValue& value = it->second.first;
+        value.balance += sign * amount;
+        if (amount > 0) {
+            value.received += sign * amount;
+        }
+        if (it->second.second != key.txhash) {
+            value.txCount += sign;
+            it->second.second = key.txhash;
+        }
+    }
+    for (const auto& [address, entry] : balances) {
+        const auto key = std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(address.first, address.second));
+        if (entry.first.IsNull()) {
+            batch.Erase(key);
+        } else {
+            batch.Write(key, entry.first);
+        }
+    }
+}
+
+void AddressIndex::DB::UpdateAddressUnspentIndex(CDBBatch& batch, const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vect) const
+{
+    for (const auto& [key, value] : vect) {
+        if (value.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, key));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, key), value);
+        }
+    }
+}
+
+void AddressIndex::DB::UpdateSpentIndex(CDBBatch& batch, const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& vect) const
+{
+    for (const auto& [key, value] : vect) {
+        if (value.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, key));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, key), value);
+        }
+    }
+}
+
+bool AddressIndex::DB::ScanAddressIndex(const uint256& addressHash, int type, int start, int end, const CAddressIndexKey* from,
+                                        const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                                        std::optional<CAddressIndexKey>& next)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    next.reset();
+
+    if (from) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, *from));
+    } else if (start > 0 && end > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != (unsigned int)type || key.second.hashBytes != addressHash) {
+            break;
+        }
+        if (end > 0 && key.second.blockHeight > end) {
+            break;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("failed to get address index value");
+        }
+        if (!fn(key.second, nValue)) {
+            next = key.second;
+            break;
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+/** Order of the deltas of a merged scan: by position in the chain, then by address. */
+static bool DeltaBefore(const CAddressIndexKey& a, const CAddressIndexKey& b)
+{
+    return std::tie(a.blockHeight, a.txindex, a.type, a.hashBytes, a.index, a.spending) <
+           std::tie(b.blockHeight, b.txindex, b.type, b.hashBytes, b.index, b.spending);
+}
+
+namespace {
+/** Position of one address in a merged scan. */
+struct AddressDeltaCursor {
+    std::unique_ptr<CDBIterator> it;
+    CAddressIndexKey key;
+    CAmount value{0};
+    bool valid{false};
+    bool failed{false};
+
+    /** Read the entry under the iterator, skipping entries before from. */
+    void Load(unsigned int type, const uint256& addressHash, int end, const CAddressIndexKey* from)
+    {
+        valid = false;
+        for (; it->Valid(); it->Next()) {
+            std::pair<uint8_t, CAddressIndexKey> db_key;
+            if (!it->GetKey(db_key) || db_key.first != DB_ADDRESSINDEX || db_key.second.type != type || db_key.second.hashBytes != addressHash) {
+                return;
+            }
+            if (end > 0 && db_key.second.blockHeight > end) {
+                return;
+            }
+            if (from && DeltaBefore(db_key.second, *from)) {
+                continue;
+            }
+            if (!it->GetValue(value)) {
+                failed = true;
+                return;
+            }
+            key = db_key.second;
+            valid = true;
+            return;
+        }
+    }
+};
+} // namespace
+
+/*
+ * k-way merge of one iterator per address. After the initial seeks each
+ * step only advances the iterator of the delta just visited, so the cost
+ * follows the number of deltas visited rather than the size of the histories.
+ */
+bool AddressIndex::DB::MergeAddressIndex(const std::vector<std::pair<uint256, int> >& addresses, int start, int end, const CAddressIndexKey* from,
+                                         const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                                         std::optional<CAddressIndexKey>& next)
+{
+    next.reset();
+
+    std::vector<AddressDeltaCursor> cursors(addresses.size());
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        const auto& [addressHash, type] = addresses[i];
+        AddressDeltaCursor& cursor = cursors[i];
+        cursor.it.reset(NewIterator());
+        if (from) {
+            // Resume at the block position of the cursor; entries of this
+            // address that the merge order puts before it are skipped by Load.
+            cursor.it->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, addressHash, from->blockHeight, from->txindex, uint256(), 0, false)));
+        } else if (start > 0 && end > 0) {
+            cursor.it->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+        } else {
+            cursor.it->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+        }
+        cursor.Load(type, addressHash, end, from);
+    }
+
+    auto later = [&](size_t a, size_t b) { return DeltaBefore(cursors[b].key, cursors[a].key); };
+    std::vector<size_t> heap;
+    heap.reserve(cursors.size());
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (cursors[i].failed) return error("failed to get address index value");
+        if (cursors[i].valid) heap.push_back(i);
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const size_t i = heap.back();
+        AddressDeltaCursor& cursor = cursors[i];
+        if (!fn(cursor.key, cursor.value)) {
+            next = cursor.key;
+            break;
+        }
+        cursor.it->Next();
+        cursor.Load(addresses[i].second, addresses[i].first, end, nullptr);
+        if (cursor.failed) return error("failed to get address index value");
+        if (cursor.valid) {
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndex(const uint256& addressHash, int type,
+                                               std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != (unsigned int)type || key.second.hashBytes != addressHash) {
+            break;
+        }
+        CAddressUnspentValue nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("failed to get address unspent value");
+        }
+        unspentOutputs.push_back(std::make_pair(key.second, nValue));
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+/** Bytes of legacy entries erased from the block tree DB per commit. */
+static constexpr size_t LEGACY_ERASE_BYTES = 1 << 24; // 16 MiB
+
+/**
+ * Erase the entries under a prefix, writing at most max_bytes of deletes.
+ * The budget left is returned in max_bytes, so a non-zero value means no
+ * entry is left under the prefix.
+ */
+template <typename Key>
+static bool EraseLegacyEntries(CDBWrapper& db, uint8_t prefix, size_t& max_bytes)
+{
+    if (max_bytes == 0) return true;
+    const size_t batch_size = 1 << 24; // 16 MiB
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    CDBBatch batch(db);
+    std::optional<std::pair<uint8_t, Key>> first, last;
+    size_t written = 0;
+    for (pcursor->Seek(prefix); pcursor->Valid(); pcursor->Next()) {
+        std::pair<uint8_t, Key> key;
+        if (!pcursor->GetKey(key) || key.first != prefix) {
+            break;
+        }
+        batch.Erase(key);
+        if (!first) first = key;
+        last = key;
+        if (batch.SizeEstimate() >= std::min(batch_size, max_bytes - written)) {
+            if (!db.WriteBatch(batch)) return false;
+            written += batch.SizeEstimate();
+            batch.Clear();
+            if (written >= max_bytes) break;
+        }
+    }
+    if (!first) return true;
+    if (!db.WriteBatch(batch)) return false;
+    written += batch.SizeEstimate();
+    max_bytes -= std::min(written, max_bytes);
+    // Compact the erased range so the next pass does not step over the deletes
+    db.CompactRange(*first, *last);
+    return true;
+}
+
+/**
+ * Erase up to max_bytes of the address indexes older versions kept in the
+ * block tree DB. complete is set once none are left.
+ */
+static bool EraseLegacyAddressIndex(CBlockTreeDB& block_tree_db, size_t max_bytes, bool& complete)
+{
+    bool f_legacy_flag = false;
+    block_tree_db.ReadFlag("addrindex", f_legacy_flag);
+    if (f_legacy_flag) {
+        LogPrintf("Removing the legacy address index from the block index database...\n");
+        // Unset the flag first, a partially erased legacy index is never used
+        // again. The erase itself resumes after a restart.
+        if (!block_tree_db.WriteFlag("legacyaddrindex", true) || !block_tree_db.WriteFlag("addrindex", false)) {
+            return error("%s: cannot write block index db flag", __func__);
+        }
+    }
+    if (!EraseLegacyEntries<CAddressIndexKey>(block_tree_db, DB_ADDRESSINDEX, max_bytes) ||
+        !EraseLegacyEntries<CAddressUnspentKey>(block_tree_db, DB_ADDRESSUNSPENTINDEX, max_bytes) ||
+        !EraseLegacyEntries<CTimestampIndexKey>(block_tree_db, DB_TIMESTAMPINDEX, max_bytes) ||
+        !EraseLegacyEntries<CTimestampBlockIndexKey>(block_tree_db, DB_BLOCKHASHINDEX, max_bytes) ||
+        !EraseLegacyEntries<CSpentIndexKey>(block_tree_db, DB_SPENTINDEX, max_bytes)) {
+        return false;
+    }
+    complete = max_bytes > 0;
+    if (complete) {
+        if (!block_tree_db.WriteFlag("legacyaddrindex", false)) {
+            return error("%s: cannot write block index db flag", __func__);
+        }
+        LogPrintf("Removed the legacy address index from the block index database\n");
+    }
+    return true;
+}
+
+bool AddressIndex::DB::EraseTimestampIndex()
+{
+    size_t unbounded = std::numeric_limits<size_t>::max();
+    return EraseLegacyEntries<CTimestampIndexKey>(*this, DB_TIMESTAMPINDEX, unbounded) &&
+           EraseLegacyEntries<CTimestampBlockIndexKey>(*this, DB_BLOCKHASHINDEX, unbounded);
+}
+
+bool AddressIndex::CommitInternal(CDBBatch& batch)
+{
+    // The legacy indexes stay usable by older versions until this index has
+    // caught up, so a downgrade or an index that never syncs loses nothing.
+    // They are then erased a bounded chunk per commit, so a commit never
+    // stalls on deleting the whole of them.
+    if (GetSummary().synced && m_legacy_data) {
+        bool complete = false;
+        if (!EraseLegacyAddressIndex(*pblocktree, LEGACY_ERASE_BYTES, complete)) {
+            return false;
+        }
+        if (complete) m_legacy_data = false;
+    }
+    return BaseIndex::CommitInternal(batch);
+}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    if (!m_db->EraseTimestampIndex()) {
+        return false;
+    }
+    bool f_legacy_flag = false, f_legacy_erase = false;
+    pblocktree->ReadFlag("addrindex", f_legacy_flag);
+    pblocktree->ReadFlag("legacyaddrindex", f_legacy_erase);
+    m_legacy_data = f_legacy_flag || f_legacy_erase;
+
+    if (!BaseIndex::Init()) {
+        return false;
+    }
+
+    uint256 applied_hash;
+    if (!m_db->Read(DB_APPLIED_TIP, applied_hash)) {
+        return true;
+    }
+
+    LOCK(cs_main);
+    const CBlockIndex* applied_tip = m_chainstate->m_blockman.LookupBlockIndex(applied_hash);
+    if (!applied_tip) {
+        return error("%s: last indexed block %s not found", __func__, applied_hash.ToString());
+    }
+
+    // Undo the blocks indexed on a branch that is no longer active
+    const CBlockIndex* fork = m_chainstate->m_chain.FindFork(applied_tip);
+    const auto& consensus_params = Params().GetConsensus();
+    while (applied_tip != fork) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, applied_tip, consensus_params)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, applied_tip->GetBlockHash().ToString());
+        }
+        m_applied_tip = applied_tip;
+        if (!UpdateBlock(block, applied_tip, false)) {
+            return false;
+        }
+        applied_tip = applied_tip->pprev;
+    }
+    m_applied_tip = applied_tip;
+    return true;
+}
+
+static bool GetIndexAddress(const COutPoint& outpoint, const CScript& script, uint256& hashBytes, int& type)
+{
+    CTxDestination dest;
+    if (!ExtractDestination(outpoint, script, dest)) {
+        return false;
+    }
+    valtype bytesID(std::visit(DataVisitor(), dest));
+    if (bytesID.empty()) {
+        return false;
+    }
+    valtype addressBytes(32);
+    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+    hashBytes = uint256(addressBytes);
+    type = dest.index();
+    return true;
+}
+
+bool AddressIndex::UpdateBlock(const CBlock& block, const CBlockIndex* pindex, bool fConnect)
+{
+    CBlockUndo block_undo;
+    if (pindex->nHeight > 0) {
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: Failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: block and undo data inconsistent", __func__);
+        }
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+        uint256 addressHash;
+        int addressType;
+
+        if (!tx.IsCoinBase()) {
+            const CTxUndo& txundo = block_undo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: transaction and undo data inconsistent", __func__);
+            }
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = txundo.vprevout[j];
+                if (!GetIndexAddress(prevout, coin.out.scriptPubKey, addressHash, addressType)) {
+                    continue;
+                }
+                addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, addressHash, pindex->nHeight, i, txhash, j, true), coin.out.nValue * -1));
+                if (fConnect) {
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, addressHash, prevout.hash, prevout.n), CAddressUnspentValue()));
+                    spentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, coin.out.nValue, addressType, addressHash)));
+                } else {
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, addressHash, prevout.hash, prevout.n), CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight)));
+                    spentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue()));
+                }
+            }
+        }
+
+        for (size_t k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            if (!GetIndexAddress(COutPoint(txhash, k), out.scriptPubKey, addressHash, addressType)) {
+                continue;
+            }
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, addressHash, pindex->nHeight, i, txhash, k, false), out.nValue));
+            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, addressHash, txhash, k),
+                                                         fConnect ? CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight) : CAddressUnspentValue()));
+        }
+    }
+
+    // Outputs spent within the block must be restored after their creation is undone
+    if (!fConnect) {
+        std::reverse(addressUnspentIndex.begin(), addressUnspentIndex.end());
+    }
+
+    CDBBatch batch(*m_db);
+    m_db->UpdateAddressIndex(batch, addressIndex, !fConnect);
+    m_db->UpdateAddressUnspentIndex(batch, addressUnspentIndex);
+    m_db->UpdateSpentIndex(batch, spentIndex);
+
+    batch.Write(DB_APPLIED_TIP, fConnect ? pindex->GetBlockHash() : pindex->pprev->GetBlockHash());
+
+    if (!m_db->WriteBatch(batch)) {
+        return false;
+    }
+    m_applied_tip = fConnect ? pindex : pindex->pprev;
+    return true;
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Already indexed before an unclean shutdown
+    if (m_applied_tip && m_applied_tip->GetAncestor(pindex->nHeight) == pindex) {
+        return true;
+    }
+    return UpdateBlock(block, pindex, true);
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Blocks replayed after an unclean shutdown may not have been reached yet
+    const CBlockIndex* start_tip = current_tip;
+    if (m_applied_tip && m_applied_tip->GetAncestor(current_tip->nHeight) == current_tip) {
+        start_tip = m_applied_tip;
+    }
+
+    const auto& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* iter_tip = start_tip; iter_tip != new_tip; iter_tip = iter_tip->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, iter_tip, consensus_params)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, iter_tip->GetBlockHash().ToString());
+        }
+        if (!UpdateBlock(block, iter_tip, false)) {
+            return false;
+        }
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::FindAddressDeltas(const uint256& addressHash, int type,
+                                     std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                                     int start, int end) const
+{
+    std::optional<CAddressIndexKey> next;
+    return m_db->ScanAddressIndex(addressHash, type, start, end, nullptr, [&](const CAddressIndexKey& key, CAmount amount) {
+        addressIndex.emplace_back(key, amount);
+        return true;
+    }, next);
+}
+
+bool AddressIndex::ScanAddressDeltas(const uint256& addressHash, int type, int start, int end, const CAddressIndexKey* from,
+                                     const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                                     std::optional<CAddressIndexKey>& next) const
+{
+    return m_db->ScanAddressIndex(addressHash, type, start, end, from, fn, next);
+}
+
+bool AddressIndex::MergeAddressDeltas(const std::vector<std::pair<uint256, int> >& addresses, int start, int end, const CAddressIndexKey* from,
+                                      const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                                      std::optional<CAddressIndexKey>& next) const
+{
+    std::vector<std::pair<uint256, int> > unique_addresses(addresses);
+    std::sort(unique_addresses.begin(), unique_addresses.end());
+    unique_addresses.erase(std::unique(unique_addresses.begin(), unique_addresses.end()), unique_addresses.end());
+    return m_db->MergeAddressIndex(unique_addresses, start, end, from, fn, next);
+}
+
+bool AddressIndex::FindAddressUnspent(const uint256& addressHash, int type,
+                                      std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const
+{
+    return m_db->ReadAddressUnspentIndex(addressHash, type, unspentOutputs);
+}
+
+bool AddressIndex::FindAddressUnspent(const std::vector<std::pair<uint256, int> >& addresses,
+                                      std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const
+{
+    for (const auto& [addressHash, type] : addresses) {
+        if (!m_db->ReadAddressUnspentIndex(addressHash, type, unspentOutputs)) return false;
+    }
+    return true;
+}
+
+bool AddressIndex::FindAddressBalance(const uint256& addressHash, int type, CAddressBalanceValue& balance) const
+{
+    if (!m_db->Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance)) {
+        balance.SetNull();
+    }
+    return true;
+}
+
+bool AddressIndex::FindSpentInfo(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return m_db->Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+std::string EncodeAddressCursor(const CAddressIndexKey& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    return HexStr(ss);
+}
+
+bool DecodeAddressCursor(const std::string& cursor, const std::vector<std::pair<uint256, int> >& addresses, CAddressIndexKey& key)
+{
+    if (cursor.size() != 2 * key.GetSerializeSize(SER_DISK, CLIENT_VERSION) || !IsHex(cursor)) {
+        return false;
+    }
+    std::vector<unsigned char> data(ParseHex(cursor));
+    CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+    ss >> key;
+    return std::find(addresses.begin(), addresses.end(), std::make_pair(key.hashBytes, (int)key.type)) != addresses.end();
+}
@@ -0,0 +1,428 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MICRO_INDEX_ADDRESSINDEX_H
+#define MICRO_INDEX_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <coins.h>
+#include <index/base.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Largest page of a paginated address query
+static constexpr size_t MAX_ADDRESS_PAGE_SIZE{10000};
+//! Most addresses a merged history query reads at once, with one iterator each
+static constexpr size_t MAX_ADDRESS_QUERY_SIZE{100};
+
+// Keys of the timestamp index older versions kept, only read to erase it.
+struct CTimestampIndexKey {
+    unsigned int timestamp;
+    uint256 blockHash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 36;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata32be(s, timestamp);
+        blockHash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        timestamp = ser_readdata32be(s);
+        blockHash.Unserialize(s);
+    }
+
+    CTimestampIndexKey(unsigned int time, uint256 hash) {
+        timestamp = time;
+        blockHash = hash;
+    }
+
+    CTimestampIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        timestamp = 0;
+        blockHash.SetNull();
+    }
+};
+
+struct CTimestampBlockIndexKey {
+    uint256 blockHash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        blockHash.Serialize(s);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        blockHash.Unserialize(s);
+    }
+
+    CTimestampBlockIndexKey(uint256 hash) {
+        blockHash = hash;
+    }
+
+    CTimestampBlockIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        blockHash.SetNull();
+    }
+};
+
+struct CAddressUnspentKey {
+    unsigned int type;
+    uint256 hashBytes;
+    uint256 txhash;
+    size_t index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 69;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+
+    CAddressUnspentKey(unsigned int addressType, uint256 addressHash, uint256 txid, size_t indexValue) {
+        type = addressType;
+        hashBytes = addressHash;
+        txhash = txid;
+        index = indexValue;
+    }
+
+    CAddressUnspentKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+    }
+};
+
+struct CAddressUnspentValue {
+    CAmount satoshis;
+    CScript script;
+    int blockHeight;
+    bool coinStake;
+
+    SERIALIZE_METHODS(CAddressUnspentValue, obj) { READWRITE(obj.satoshis, *(CScriptBase*)(&obj.script), obj.blockHeight); }
+
+    CAddressUnspentValue(CAmount sats, CScript scriptPubKey, int height) {
+        satoshis = sats;
+        script = scriptPubKey;
+        blockHeight = height;
+    }
+
+    CAddressUnspentValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        satoshis = -1;
+        script.clear();
+        blockHeight = 0;
+    }
+
+    bool IsNull() const {
+        return (satoshis == -1);
+    }
+};
+
+struct CAddressIndexKey {
+    unsigned int type;
+    uint256 hashBytes;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    size_t index;
+    bool spending;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 78;
+    }
+    template<typename Stream>
+   void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+        char f = spending;
+        ser_writedata8(s, f);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+        char f = ser_readdata8(s);
+        spending = f;
+    }
+
+    CAddressIndexKey(unsigned int addressType, uint256 addressHash, int height, int blockindex,
+                     uint256 txid, size_t indexValue, bool isSpending) {
+        type = addressType;
+        hashBytes = addressHash;
+        blockHeight = height;
+        txindex = blockindex;
+        txhash = txid;
+        index = indexValue;
+        spending = isSpending;
+    }
+
+    CAddressIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+        index = 0;
+        spending = false;
+    }
+
+};
+
+struct CAddressIndexIteratorHeightKey {
+    unsigned int type;
+    uint256 hashBytes;
+    int blockHeight;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 37;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ser_writedata32be(s, blockHeight);
+   }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+    }
+
+    CAddressIndexIteratorHeightKey(unsigned int addressType, uint256 addressHash, int height) {
+        type = addressType;
+        hashBytes = addressHash;
+        blockHeight = height;
+    }
+
+    CAddressIndexIteratorHeightKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        blockHeight = 0;
+    }
+};
+
+struct CAddressIndexIteratorKey {
+    unsigned int type;
+    uint256 hashBytes;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 33;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+    }
+
+    CAddressIndexIteratorKey(unsigned int addressType, uint256 addressHash) {
+        type = addressType;
+        hashBytes = addressHash;
+    }
+
+    CAddressIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+    }
+};
+
+/**
+ * Running totals of the address index deltas of one address, kept up to date
+ * with the deltas so the balance does not need a scan of the address history.
+ */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    int64_t txCount;
+
+    SERIALIZE_METHODS(CAddressBalanceValue, obj) { READWRITE(obj.balance, obj.received, obj.txCount); }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+    }
+
+    bool IsNull() const {
+        return (txCount == 0);
+    }
+};
+
+/**
+ * AddressIndex maintains the address, address unspent and spent indexes used
+ * by the insight-style RPCs. It is written to its own LevelDB
+ * database and synced in the background like the other indexes, so block
+ * connection does not wait for it.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Last block whose entries are in the database. This can be ahead of the
+    /// committed best block after an unclean shutdown, and the balance records
+    /// must not see those blocks twice.
+    const CBlockIndex* m_applied_tip{nullptr};
+
+    /// Whether the block tree DB still holds the indexes of older versions.
+    /// They are kept until this index has caught up with the chain, then
+    /// erased a chunk per commit.
+    std::atomic<bool> m_legacy_data{false};
+
+    /// Write the entries of a block, or undo them when disconnecting it.
+    bool UpdateBlock(const CBlock& block, const CBlockIndex* pindex, bool fConnect);
+
+protected:
+    /// Override base class init to drop the timestamp indexes and recover the applied tip.
+    bool Init() override;
+
+    /// Override base class commit to erase the legacy indexes once in sync.
+    bool CommitInternal(CDBBatch& batch) override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Balance changes of an address, optionally limited to the heights [start, end].
+    bool FindAddressDeltas(const uint256& addressHash, int type,
+                           std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                           int start = 0, int end = 0) const;
+
+    /**
+     * Visit the balance changes of an address in height order straight from the
+     * database iterator, without collecting them. The scan starts at the key
+     * from, or when it is null at height start if both start and end are
+     * positive, and ends after height end when that is positive. If fn returns
+     * false the scan stops and next is set to the key it declined, so a later
+     * scan can resume from there.
+     */
+    bool ScanAddressDeltas(const uint256& addressHash, int type, int start, int end, const CAddressIndexKey* from,
+                           const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                           std::optional<CAddressIndexKey>& next) const;
+
+    /**
+     * Like ScanAddressDeltas, over several addresses at once: the deltas are
+     * merged from one iterator per address, ordered by height and position in
+     * the block, then by address. Duplicate addresses are visited once.
+     */
+    bool MergeAddressDeltas(const std::vector<std::pair<uint256, int> >& addresses, int start, int end, const CAddressIndexKey* from,
+                            const std::function<bool(const CAddressIndexKey&, CAmount)>& fn,
+                            std::optional<CAddressIndexKey>& next) const;
+
+    /// Unspent outputs of an address.
+    bool FindAddressUnspent(const uint256& addressHash, int type,
+                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const;
+
+    /// Unspent outputs of several addresses, in the order of the addresses.
+    bool FindAddressUnspent(const std::vector<std::pair<uint256, int> >& addresses,
+                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs) const;
+
+    /// Balance, total received and transaction count of an address.
+    bool FindAddressBalance(const uint256& addressHash, int type, CAddressBalanceValue& balance) const;
+
+    /// The input spending an output, if any.
+    bool FindSpentInfo(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+};
+
+/// The global address index, used by the address RPCs. May be null.
+extern std::unique_ptr<AddressIndex> g_address_index;
+
+/**
+ * Continuation cursor of a paginated address query: the hex of the index key
+ * to resume at, which starts with its CAddressIndexIteratorHeightKey. Clients
+ * treat it as opaque.
+ */
+std::string EncodeAddressCursor(const CAddressIndexKey& key);
+
+/// Decode a cursor, failing if it is malformed or belongs to none of the queried addresses.
+bool DecodeAddressCursor(const std::string& cursor, const std::vector<std::pair<uint256, int> >& addresses, CAddressIndexKey& key);
+
+#endif // MICRO_INDEX_ADDRESSINDEX_H
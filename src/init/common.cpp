@@ -8,7 +8,10 @@
 
 #include <clientversion.h>
 #include <compat/sanity.h>
+#include <crypto/blake2b.h>
 #include <crypto/sha256.h>
+#include <crypto/yespower/yespower.h>
+#include <init/common.h>
 #include <key.h>
 #include <logging.h>
 #include <node/ui_interface.h>
@@ -27,6 +30,15 @@ void SetGlobals()
 {
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string blake2b_algo = Blake2bAutoDetect();
+    LogPrintf("Using the '%s' BLAKE2b implementation\n", blake2b_algo);
+    const std::string yespower_impl = gArgs.GetArg("-yespowerimpl", DEFAULT_YESPOWER_IMPL);
+    std::string yespower_algo = YespowerAutoDetect(yespower_impl);
+    if (yespower_algo.empty()) {
+        yespower_algo = "generic";
+        InitWarning(strprintf(_("The yespower implementation '%s' is not available, using '%s' instead."), yespower_impl, yespower_algo));
+    }
+    LogPrintf("Using the '%s' yespower implementation\n", yespower_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
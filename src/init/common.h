@@ -10,6 +10,9 @@
 
 class ArgsManager;
 
+//! Default for -yespowerimpl
+static const char* const DEFAULT_YESPOWER_IMPL = "auto";
+
 namespace init {
 void SetGlobals();
 void UnsetGlobals();
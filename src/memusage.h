@@ -7,6 +7,7 @@
 
 #include <indirectmap.h>
 #include <prevector.h>
+#include <support/allocators/pool.h>
 
 #include <stdlib.h>
 
@@ -167,6 +168,17 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template <class Key, class T, class Hash, class Pred, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<Key, T, Hash, Pred, PoolAllocator<std::pair<const Key, T>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>>& m)
+{
+    // Nodes live in the chunks of the pool, which are held until it is
+    // destroyed, each listed in a std::list node of three pointers.
+    const auto* pool_resource = m.get_allocator().resource();
+    const size_t chunks = pool_resource->NumAllocatedChunks();
+    return (MallocUsage(sizeof(void*) * 3) + MallocUsage(pool_resource->ChunkSizeBytes())) * chunks +
+           MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif // MICRO_MEMUSAGE_H
@@ -20,6 +20,7 @@
 #include <cstdio>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <thread>
 
 #include <boost/algorithm/string.hpp>
@@ -92,16 +93,16 @@ static void grind_task(uint32_t nBits, CBlockHeader& header_orig, uint32_t offse
     finish = finish - (finish % step) + offset;
 
     while (!found && header.nNonce < finish) {
-        const uint32_t next = (finish - header.nNonce < 5000*step) ? finish : header.nNonce + 5000*step;
-        do {
-            if (UintToArith256(header.GetWorkHash()) <= target) {
-                if (!found.exchange(true)) {
-                    header_orig.nNonce = header.nNonce;
-                }
-                return;
+        // Sweep up to 5000 nonces of this task between checks of found.
+        const uint32_t count = std::min<uint32_t>(5000, (finish - header.nNonce) / step);
+        const std::optional<uint32_t> nonce = SweepNonces(header, target, header.nNonce, count, step);
+        if (nonce) {
+            if (!found.exchange(true)) {
+                header_orig.nNonce = *nonce;
             }
-            header.nNonce += step;
-        } while(header.nNonce != next);
+            return;
+        }
+        header.nNonce += count * step;
     }
 }
 
@@ -2040,14 +2040,19 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, const Peer& peer,
             return;
         }
 
-        uint256 hashLastBlock;
+        std::vector<const CBlockHeaderUncached*> header_ptrs;
         for (const CBlockHeader& header : headers) {
-            if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
+            header_ptrs.push_back(&header);
+        }
+        std::vector<uint256> hashes(nCount);
+        GetIndexHashes(header_ptrs, hashes);
+        for (size_t i = 1; i < nCount; ++i) {
+            if (headers[i].hashPrevBlock != hashes[i - 1]) {
                 Misbehaving(pfrom.GetId(), 20, "non-continuous headers sequence");
                 return;
             }
-            hashLastBlock = header.GetIndexHash();
         }
+        const uint256& hashLastBlock = hashes.back();
 
         // If we don't have the last header, then they'll have given us
         // something new (if these headers are valid).
@@ -16,14 +16,19 @@
 #include <signet.h>
 #include <streams.h>
 #include <undo.h>
+#include <util/hasher.h>
 #include <util/system.h>
 #include <validation.h>
 
+#include <list>
+#include <unordered_map>
+
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fHavePruned = false;
 bool fPruneMode = false;
 uint64_t nPruneTarget = 0;
+bool fCheckBlockReads = DEFAULT_CHECKBLOCKREADS;
 
 // TODO make namespace {
 RecursiveMutex cs_LastBlockFile;
@@ -362,7 +367,7 @@ bool WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValidationState& st
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
+bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams, bool fCheckPOW)
 {
     block.SetNull();
 
@@ -380,7 +385,7 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
     }
 
     // Check the header
-    if (!CheckProofOfWork(block.GetWorkHash(), block.nBits, consensusParams)) {
+    if (fCheckPOW && !CheckProofOfWork(block.GetWorkHashCached(), block.nBits, consensusParams)) {
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
     }
 
@@ -395,18 +400,44 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     FlatFilePos blockPos;
+    bool fHaveWorkHash;
+    uint256 hashWork;
     {
         LOCK(cs_main);
         blockPos = pindex->GetBlockPos();
+        fHaveWorkHash = pindex->cacheInit;
+        hashWork = pindex->cacheWorkHash;
     }
 
-    if (!ReadBlockFromDisk(block, blockPos, consensusParams)) {
+    // An entry loaded without its work hash gets it computed here, as the
+    // block checks would need it anyway.
+    if (!ReadBlockFromDisk(block, blockPos, consensusParams, fCheckBlockReads || !fHaveWorkHash)) {
         return false;
     }
-    if (block.GetIndexHash() != pindex->GetBlockHash()) {
+    const uint256 hash = block.GetIndexHash();
+    if (hash != pindex->GetBlockHash()) {
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                      pindex->ToString(), pindex->GetBlockPos().ToString());
     }
+    if (!fCheckBlockReads && fHaveWorkHash) {
+        // Same header as the one validated for pindex, so hand its work hash
+        // to later consumers (CheckBlock) instead of recomputing it.
+        LOCK(block.cacheLock);
+        block.cacheInit = true;
+        block.cacheIndexHash = hash;
+        block.cacheWorkHash = hashWork;
+    } else if (!fHaveWorkHash) {
+        // Keep the hash on the index entry and have it written back, so the
+        // record is upgraded instead of hashed again on the next start.
+        LOCK2(cs_main, block.cacheLock);
+        CBlockIndex* pindexUpgrade = const_cast<CBlockIndex*>(pindex);
+        if (!pindexUpgrade->cacheInit) {
+            pindexUpgrade->cacheIndexHash = hash;
+            pindexUpgrade->cacheWorkHash = block.cacheWorkHash;
+            pindexUpgrade->cacheInit = true;
+            setDirtyBlockIndex.insert(pindexUpgrade);
+        }
+    }
     return true;
 }
 
@@ -456,6 +487,71 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
     return ReadRawBlockFromDisk(block, block_pos, message_start);
 }
 
+namespace {
+/** Serialized blocks by hash, most recently used first, up to RAW_BLOCK_CACHE_SIZE bytes. */
+class RawBlockCache
+{
+private:
+    typedef std::pair<uint256, std::shared_ptr<const std::vector<uint8_t>>> Entry;
+
+    Mutex m_mutex;
+    std::list<Entry> m_entries GUARDED_BY(m_mutex);
+    std::unordered_map<uint256, std::list<Entry>::iterator, BlockHasher> m_by_hash GUARDED_BY(m_mutex);
+    size_t m_size GUARDED_BY(m_mutex){0};
+
+public:
+    std::shared_ptr<const std::vector<uint8_t>> Get(const uint256& hash)
+    {
+        LOCK(m_mutex);
+        const auto it = m_by_hash.find(hash);
+        if (it == m_by_hash.end()) return nullptr;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->second;
+    }
+
+    void Put(const uint256& hash, std::shared_ptr<const std::vector<uint8_t>> block)
+    {
+        if (block->size() > RAW_BLOCK_CACHE_SIZE) return;
+        LOCK(m_mutex);
+        if (m_by_hash.count(hash)) return;
+        m_size += block->size();
+        m_entries.emplace_front(hash, std::move(block));
+        m_by_hash.emplace(hash, m_entries.begin());
+        while (m_size > RAW_BLOCK_CACHE_SIZE) {
+            m_size -= m_entries.back().second->size();
+            m_by_hash.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+    }
+};
+
+RawBlockCache g_raw_block_cache;
+} // namespace
+
+std::shared_ptr<const std::vector<uint8_t>> ReadRawBlockCached(const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    if (auto block = g_raw_block_cache.Get(hash)) return block;
+
+    auto block = std::make_shared<std::vector<uint8_t>>();
+    if (!ReadRawBlockFromDisk(*block, pindex, message_start)) {
+        return nullptr;
+    }
+    CBlockHeaderUncached header;
+    try {
+        VectorReader(SER_DISK, CLIENT_VERSION, *block, 0) >> header;
+    } catch (const std::exception& e) {
+        error("%s: Deserialize error - %s for %s", __func__, e.what(), pindex->ToString());
+        return nullptr;
+    }
+    if (header.GetIndexHash() != hash) {
+        error("%s: GetHash() doesn't match index for %s", __func__, pindex->ToString());
+        return nullptr;
+    }
+    g_raw_block_cache.Put(hash, block);
+    return block;
+}
+
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp)
 {
@@ -212,7 +212,7 @@ public:
     uint256 getBestBlockHash() override
     {
         const CBlockIndex* tip = WITH_LOCK(::cs_main, return chainman().ActiveChain().Tip());
-        return tip ? tip->GetBlockHash() : Params().GenesisBlock().GetIndexHash();
+        return tip ? tip->GetBlockHash() : Params().GetConsensus().hashGenesisBlock;
     }
     int64_t getLastBlockTime() override
     {
@@ -220,7 +220,7 @@ public:
         if (chainman().ActiveChain().Tip()) {
             return chainman().ActiveChain().Tip()->GetBlockTime();
         }
-        return Params().GenesisBlock().GetBlockTime(); // Genesis block's time of current network
+        return Params().GenesisBlockHeader().GetBlockTime(); // Genesis block's time of current network
     }
     double getVerificationProgress() override
     {
@@ -10,8 +10,12 @@
 #include <arith_uint256.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <uint256.h>
 
+#include <array>
+#include <vector>
+
 unsigned int Lwma3CalculateNextWorkRequired(const CBlockIndex* pindexLast, const Consensus::Params& params)
 {
     const int64_t T = params.nPowTargetSpacing;
@@ -62,10 +66,177 @@ unsigned int Lwma3CalculateNextWorkRequired(const CBlockIndex* pindexLast, const
     return nextTarget.GetCompact();
 }
 
+namespace {
+
+/**
+ * The LWMA3 sums over the lwmaAveragingWindow blocks ending at some block,
+ * kept up to date as the window slides one block forward. Moving the window
+ * from a block to one of its children costs O(1); any other move rebuilds it
+ * from the block index. The result matches Lwma3CalculateNextWorkRequired()
+ * bit for bit.
+ */
+class Lwma3Window
+{
+private:
+    struct Entry {
+        //! Timestamp as used by LWMA3, forced to increase over the window.
+        int64_t timestamp;
+        //! Whether timestamp had to be raised above the block's own.
+        bool raised;
+        int64_t solvetime;
+        //! The block target divided by k * N.
+        arith_uint256 share;
+    };
+
+    const CBlockIndex* m_tip{nullptr};
+    uint256 m_tip_hash;
+    int m_tip_height{-1};
+    uint32_t m_tip_time{0};
+    uint32_t m_tip_bits{0};
+
+    //! The window, oldest entry first starting at m_head.
+    std::vector<Entry> m_entries;
+    size_t m_head{0};
+    arith_uint256 m_sum_target;
+    int64_t m_weighted_solvetimes{0};
+    int64_t m_solvetimes{0};
+
+    void SetTip(const CBlockIndex* tip)
+    {
+        m_tip = tip;
+        m_tip_hash = tip->phashBlock ? tip->GetBlockHash() : uint256();
+        m_tip_height = tip->nHeight;
+        m_tip_time = tip->nTime;
+        m_tip_bits = tip->nBits;
+    }
+
+    static Entry MakeEntry(const CBlockIndex* block, int64_t previous_timestamp, const Consensus::Params& params)
+    {
+        const int64_t T = params.nPowTargetSpacing;
+        const int64_t N = params.lwmaAveragingWindow;
+        const int64_t k = N * (N + 1) * T / 2;
+        Entry entry;
+        entry.raised = block->GetBlockTime() <= previous_timestamp;
+        entry.timestamp = entry.raised ? previous_timestamp + 1 : block->GetBlockTime();
+        entry.solvetime = std::min(6 * T, entry.timestamp - previous_timestamp);
+        entry.share.SetCompact(block->nBits);
+        entry.share /= k * N;
+        return entry;
+    }
+
+    const Entry& Back(size_t i) const
+    {
+        return m_entries[(m_head + m_entries.size() - 1 - i) % m_entries.size()];
+    }
+
+public:
+    /** Whether the window ends at pindex. */
+    bool EndsAt(const CBlockIndex* pindex) const
+    {
+        return pindex == m_tip && pindex->nHeight == m_tip_height && pindex->nTime == m_tip_time &&
+               pindex->nBits == m_tip_bits && (!pindex->phashBlock || pindex->GetBlockHash() == m_tip_hash);
+    }
+
+    /** Make the window end at pindexLast, whose height must be at least N. */
+    void MoveTo(const CBlockIndex* pindexLast, const Consensus::Params& params)
+    {
+        const int64_t N = params.lwmaAveragingWindow;
+        if (EndsAt(pindexLast)) return;
+
+        // Sliding forward drops the oldest block, whose timestamp becomes the
+        // base of the window. That only leaves the other entries as they are
+        // if the block's timestamp did not have to be raised.
+        if (pindexLast->pprev && EndsAt(pindexLast->pprev) && !m_entries[m_head].raised) {
+            const Entry& oldest = m_entries[m_head];
+            m_weighted_solvetimes -= m_solvetimes;
+            m_solvetimes -= oldest.solvetime;
+            m_sum_target -= oldest.share;
+
+            const Entry entry = MakeEntry(pindexLast, Back(0).timestamp, params);
+            m_weighted_solvetimes += entry.solvetime * N;
+            m_solvetimes += entry.solvetime;
+            m_sum_target += entry.share;
+            m_entries[m_head] = entry;
+            m_head = (m_head + 1) % m_entries.size();
+            SetTip(pindexLast);
+            return;
+        }
+
+        // Rebuild the window, walking back to its base.
+        std::vector<const CBlockIndex*> blocks(N + 1);
+        const CBlockIndex* block = pindexLast;
+        for (int64_t i = N; i >= 0; --i) {
+            blocks[i] = block;
+            block = block->pprev;
+        }
+        m_entries.clear();
+        m_head = 0;
+        m_sum_target = 0;
+        m_weighted_solvetimes = 0;
+        m_solvetimes = 0;
+        int64_t previous_timestamp = blocks[0]->GetBlockTime();
+        for (int64_t j = 1; j <= N; ++j) {
+            const Entry entry = MakeEntry(blocks[j], previous_timestamp, params);
+            previous_timestamp = entry.timestamp;
+            m_weighted_solvetimes += entry.solvetime * j;
+            m_solvetimes += entry.solvetime;
+            m_sum_target += entry.share;
+            m_entries.push_back(entry);
+        }
+        SetTip(pindexLast);
+    }
+
+    /** The target of the block after the end of the window. */
+    unsigned int GetNextWorkRequired(const Consensus::Params& params) const
+    {
+        const int64_t T = params.nPowTargetSpacing;
+        const arith_uint256 powLimit = UintToArith256(params.powLimit);
+
+        arith_uint256 previousDiff;
+        previousDiff.SetCompact(m_tip_bits);
+        const int64_t solvetimeSum = Back(0).solvetime + Back(1).solvetime + Back(2).solvetime;
+
+        arith_uint256 nextTarget = m_weighted_solvetimes * m_sum_target;
+
+        if (nextTarget > (previousDiff * 150) / 100) { nextTarget = (previousDiff * 150) / 100; }
+        if (nextTarget < (previousDiff * 67) / 100) { nextTarget = (previousDiff * 67) / 100; }
+        if (solvetimeSum < (8 * T) / 10) { nextTarget = previousDiff * 100 / 106; }
+        if (nextTarget > powLimit) { nextTarget = powLimit; }
+
+        return nextTarget.GetCompact();
+    }
+};
+
+Mutex g_lwma3_mutex;
+//! Windows for the last chains asked about, e.g. the best header chain and the active chain.
+std::array<Lwma3Window, 2> g_lwma3_windows GUARDED_BY(g_lwma3_mutex);
+size_t g_lwma3_last_used GUARDED_BY(g_lwma3_mutex){0};
+
+} // namespace
+
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
 {
     assert(pindexLast != nullptr);
-    return Lwma3CalculateNextWorkRequired(pindexLast, params);
+
+    const int64_t N = params.lwmaAveragingWindow;
+    const int64_t height = pindexLast->nHeight;
+    if (height < N || (height >= params.nSubsidyHeight && height < params.nSubsidyHeight + N)) {
+        return Lwma3CalculateNextWorkRequired(pindexLast, params);
+    }
+
+    LOCK(g_lwma3_mutex);
+    // Reuse the window that ends at pindexLast or its parent, or else the
+    // least recently used one.
+    size_t slot = (g_lwma3_last_used + 1) % g_lwma3_windows.size();
+    for (size_t i = 0; i < g_lwma3_windows.size(); ++i) {
+        if (g_lwma3_windows[i].EndsAt(pindexLast) || (pindexLast->pprev && g_lwma3_windows[i].EndsAt(pindexLast->pprev))) {
+            slot = i;
+            break;
+        }
+    }
+    g_lwma3_last_used = slot;
+    g_lwma3_windows[slot].MoveTo(pindexLast, params);
+    return g_lwma3_windows[slot].GetNextWorkRequired(params);
 }
 
 bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params& params)
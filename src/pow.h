@@ -14,6 +14,15 @@ class CBlockHeader;
 class CBlockIndex;
 class uint256;
 
+/**
+ * The LWMA3 target of the block after pindexLast, computed from scratch. Walks
+ * the whole averaging window.
+ */
+unsigned int Lwma3CalculateNextWorkRequired(const CBlockIndex* pindexLast, const Consensus::Params&);
+/**
+ * The LWMA3 target of the block after pindexLast. The sums over the averaging
+ * window are cached, so calls for consecutive blocks cost O(1) each.
+ */
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params&);
 unsigned int CalculateNextWorkRequired(const CBlockIndex* pindexLast, int64_t nFirstBlockTime, const Consensus::Params&);
 
@@ -5,6 +5,9 @@
 
 #include <primitives/block.h>
 
+#include <arith_uint256.h>
+#include <crypto/blake2b.h>
+#include <crypto/common.h>
 #include <hash.h>
 #include <tinyformat.h>
 #include <crypto/yespower/yespower.h>
@@ -16,15 +19,33 @@ uint256 CBlockHeaderUncached::GetIndexHash() const
     return Blake2b(BEGIN(nVersion), END(nNonce));
 }
 
-uint256 CBlockHeaderUncached::GetWorkHash() const
+void GetIndexHashes(Span<const CBlockHeaderUncached* const> headers, Span<uint256> hashes)
 {
-    static const yespower_params_t yespower_micromicro = {
-        .N = 2048,
-        .r = 32,
-        .pers = (const uint8_t *)"Now I am become Death, the destroyer of worlds",
-        .perslen = 46
-    };
+    assert(headers.size() == hashes.size());
+
+    // The index hash covers the 80 bytes from nVersion to nNonce as laid out
+    // in memory (see GetIndexHash()); gather them a few headers at a time.
+    static constexpr size_t HEADERS_PER_CALL = 16;
+    static_assert(offsetof(CBlockHeaderUncached, nNonce) + sizeof(uint32_t) - offsetof(CBlockHeaderUncached, nVersion) == 80);
+    unsigned char data[HEADERS_PER_CALL * 80];
+    for (size_t done = 0; done < headers.size(); done += HEADERS_PER_CALL) {
+        const size_t count = std::min(HEADERS_PER_CALL, headers.size() - done);
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(data + i * 80, BEGIN(headers[done + i]->nVersion), 80);
+        }
+        Blake2b80(hashes[done].begin(), data, count);
+    }
+}
 
+static const yespower_params_t yespower_micromicro = {
+    .N = 2048,
+    .r = 32,
+    .pers = (const uint8_t *)"Now I am become Death, the destroyer of worlds",
+    .perslen = 46
+};
+
+uint256 CBlockHeaderUncached::GetWorkHash() const
+{
     uint256 thash;
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << *this;
@@ -37,16 +58,67 @@ uint256 CBlockHeaderUncached::GetWorkHash() const
     return thash;
 }
 
+void GetWorkHashes(Span<const CBlockHeaderUncached* const> headers, Span<uint256> hashes)
+{
+    assert(headers.size() == hashes.size());
+    if (headers.empty()) return;
+
+    std::vector<unsigned char> data;
+    data.reserve(headers.size() * 80);
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, data, 0);
+    for (const CBlockHeaderUncached* header : headers) {
+        writer << *header;
+    }
+    assert(data.size() == headers.size() * 80);
+
+    if (yespower_tls_batch(data.data(), 80, &yespower_micromicro, (yespower_binary_t *)hashes.data(), headers.size())) {
+        fprintf(stderr, "Error: GetWorkHashes(): failed to compute PoW hashes (out of memory?)\n");
+        exit(1);
+    }
+}
+
+std::optional<uint32_t> SweepNonces(const CBlockHeaderUncached& header, const arith_uint256& target, uint32_t nonce, uint32_t count, uint32_t step)
+{
+    std::vector<unsigned char> serialized;
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, serialized, 0) << header;
+    assert(serialized.size() == 80);
+
+    // One copy of the header per lane; the nonce is serialized last.
+    const uint32_t lanes = yespower_lanes();
+    unsigned char data[YESPOWER_MAX_LANES][80];
+    uint256 hashes[YESPOWER_MAX_LANES];
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        memcpy(data[lane], serialized.data(), 80);
+    }
+
+    while (count > 0) {
+        const uint32_t batch = std::min(lanes, count);
+        for (uint32_t lane = 0; lane < batch; ++lane) {
+            WriteLE32(&data[lane][76], nonce + lane * step);
+        }
+        if (yespower_tls_batch(&data[0][0], 80, &yespower_micromicro, (yespower_binary_t *)hashes, batch)) {
+            fprintf(stderr, "Error: SweepNonces(): failed to compute PoW hashes (out of memory?)\n");
+            exit(1);
+        }
+        for (uint32_t lane = 0; lane < batch; ++lane) {
+            if (UintToArith256(hashes[lane]) <= target) return nonce + lane * step;
+        }
+        nonce += batch * step;
+        count -= batch;
+    }
+    return std::nullopt;
+}
+
+bool SetupWorkHashScratchpads(size_t max, bool hugepages, size_t prealloc)
+{
+    return YespowerScratchpadsSetup(max, hugepages, prealloc, &yespower_micromicro);
+}
+
 uint256 CBlockHeader::GetWorkHashCached() const
 {
     uint256 indexHash = GetIndexHash();
     LOCK(cacheLock);
-    if (cacheInit) {
-        if (indexHash != cacheIndexHash) {
-            fprintf(stderr, "Error: CBlockHeader: block hash changed unexpectedly\n");
-            exit(1);
-        }
-    } else {
+    if (!cacheInit || indexHash != cacheIndexHash) {
         cacheWorkHash = GetWorkHash();
         cacheIndexHash = indexHash;
         cacheInit = true;
@@ -54,6 +126,31 @@ uint256 CBlockHeader::GetWorkHashCached() const
     return cacheWorkHash;
 }
 
+void CBlockHeader::CacheWorkHashes(Span<const CBlockHeader* const> headers)
+{
+    std::vector<const CBlockHeader*> uncached;
+    std::vector<uint256> indexHashes;
+    for (const CBlockHeader* header : headers) {
+        const uint256 indexHash = header->GetIndexHash();
+        LOCK(header->cacheLock);
+        if (!header->cacheInit || header->cacheIndexHash != indexHash) {
+            uncached.push_back(header);
+            indexHashes.push_back(indexHash);
+        }
+    }
+
+    std::vector<uint256> hashes(uncached.size());
+    GetWorkHashes(std::vector<const CBlockHeaderUncached*>(uncached.begin(), uncached.end()), hashes);
+
+    for (size_t i = 0; i < uncached.size(); ++i) {
+        const CBlockHeader* header = uncached[i];
+        LOCK(header->cacheLock);
+        header->cacheWorkHash = hashes[i];
+        header->cacheIndexHash = indexHashes[i];
+        header->cacheInit = true;
+    }
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -6,11 +6,17 @@
 #ifndef MICRO_PRIMITIVES_BLOCK_H
 #define MICRO_PRIMITIVES_BLOCK_H
 
+#include <crypto/yespower/yespower.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
+#include <span.h>
 #include <uint256.h>
 #include <sync.h>
 
+#include <optional>
+
+class arith_uint256;
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -60,9 +66,44 @@ public:
     }
 };
 
+/**
+ * Compute the index hashes of several headers with Blake2b80(), which hashes
+ * several at a time with SIMD where available. hashes[i] is the same as
+ * headers[i]->GetIndexHash().
+ */
+void GetIndexHashes(Span<const CBlockHeaderUncached* const> headers, Span<uint256> hashes);
+
+/**
+ * Compute the work hashes of several headers with one yespower_tls_batch()
+ * call, which interleaves them on the calling thread. hashes[i] is the same
+ * as headers[i]->GetWorkHash().
+ */
+void GetWorkHashes(Span<const CBlockHeaderUncached* const> headers, Span<uint256> hashes);
+
+/**
+ * Try count nonces of header, starting at nonce and advancing by step (mod
+ * 2^32), and return the first one whose work hash is at or below target. The
+ * header is serialized once; per nonce only its last four bytes are rewritten
+ * and yespower_lanes() nonces are hashed per yespower_tls_batch() call, with
+ * no allocations in the loop. Returns std::nullopt if none of the nonces
+ * qualifies.
+ */
+std::optional<uint32_t> SweepNonces(const CBlockHeaderUncached& header, const arith_uint256& target, uint32_t nonce, uint32_t count, uint32_t step = 1);
+
+/**
+ * Set up the yespower scratchpads work hashes are computed with (see
+ * YespowerScratchpadsSetup()), allocating prealloc of them right away.
+ */
+bool SetupWorkHashScratchpads(size_t max, bool hugepages, size_t prealloc);
+
 class CBlockHeader : public CBlockHeaderUncached
 {
 public:
+    /**
+     * The work hash of the header as it was when cacheIndexHash was taken.
+     * The header fields can be written at any time, so the cache only
+     * counts while the index hash still matches; otherwise it is refilled.
+     */
     mutable Mutex cacheLock;
     mutable bool cacheInit;
     mutable uint256 cacheIndexHash, cacheWorkHash;
@@ -86,7 +127,16 @@ public:
         return *this;
     }
 
+    void SetNull()
+    {
+        CBlockHeaderUncached::SetNull();
+        cacheInit = false;
+    }
+
     uint256 GetWorkHashCached() const;
+
+    /** Fill the work hash cache of those headers that have none or a stale one, in one batch. */
+    static void CacheWorkHashes(Span<const CBlockHeader* const> headers);
 };
 
 class CBlock : public CBlockHeader
@@ -7,7 +7,9 @@
 #include <chainparams.h>
 #include <core_io.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/txindex.h>
+#include <key_io.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <primitives/block.h>
@@ -271,7 +273,11 @@ static bool rest_block(const std::any& context,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    // Binary and hex blocks with witnesses are served as serialized on disk.
+    const bool raw = (rf == RetFormat::BINARY || rf == RetFormat::HEX) && !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+
     CBlock block;
+    std::shared_ptr<const std::vector<uint8_t>> raw_block;
     CBlockIndex* pblockindex = nullptr;
     CBlockIndex* tip = nullptr;
     {
@@ -288,8 +294,24 @@ static bool rest_block(const std::any& context,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        if (raw) {
+            raw_block = ReadRawBlockCached(pblockindex, Params().MessageStart());
+            if (!raw_block)
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        } else if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        }
+    }
+
+    if (raw) {
+        if (rf == RetFormat::BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, std::string(raw_block->begin(), raw_block->end()));
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(*raw_block) + "\n");
+        }
+        return true;
     }
 
     switch (rf) {
@@ -708,6 +730,108 @@ static bool rest_blockhash_by_height(const std::any& context, HTTPRequest* req,
     }
 }
 
+/**
+ * One page of the history of an address, in height order:
+ * /rest/address<deltas|txids>/<address>[,<address>...]/<limit>[/<cursor>].json
+ * The page is written out as it is merged from the index iterators, and the
+ * "next" cursor of the reply fetches the following page.
+ */
+static bool rest_address_page(HTTPRequest* req, const std::string& strURIPart, bool txids_only)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+    if (path.size() < 2 || path.size() > 3) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/address" + std::string(txids_only ? "txids" : "deltas") + "/<address>[,<address>...]/<limit>[/<cursor>].json");
+    }
+
+    std::vector<std::string> address_strs;
+    boost::split(address_strs, path[0], boost::is_any_of(","));
+    std::vector<std::pair<uint256, int> > addresses;
+    for (const std::string& address_str : address_strs) {
+        uint256 address_hash;
+        int address_type = 0;
+        if (!DecodeIndexKey(address_str, address_hash, address_type)) {
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(address_str));
+        }
+        addresses.emplace_back(address_hash, address_type);
+    }
+    if (addresses.size() > MAX_ADDRESS_QUERY_SIZE) {
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Error: max addresses exceeded (max: %u, tried: %u)", MAX_ADDRESS_QUERY_SIZE, addresses.size()));
+    }
+    int32_t limit = 0;
+    if (!ParseInt32(path[1], &limit) || limit <= 0 || (size_t)limit > MAX_ADDRESS_PAGE_SIZE) {
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Limit is expected to be between 1 and %u", MAX_ADDRESS_PAGE_SIZE));
+    }
+    std::optional<CAddressIndexKey> from;
+    if (path.size() == 3) {
+        CAddressIndexKey key;
+        if (!DecodeAddressCursor(path[2], addresses, key)) {
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid cursor: " + SanitizeString(path[2]));
+        }
+        from = key;
+    }
+
+    if (rf != RetFormat::JSON) {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    if (!g_address_index) {
+        return RESTERR(req, HTTP_NOT_FOUND, "Address index not enabled");
+    }
+    if (!g_address_index->BlockUntilSyncedToCurrentChain()) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Address index is still in the process of being synced");
+    }
+
+    std::string body = txids_only ? "{\"txids\":[" : "{\"deltas\":[";
+    int count = 0;
+    uint256 last;
+    std::optional<CAddressIndexKey> next;
+    const bool found = g_address_index->MergeAddressDeltas(addresses, 0, 0, from ? &*from : nullptr,
+        [&](const CAddressIndexKey& key, CAmount amount) {
+            if (txids_only && key.txhash == last) return true;
+            if (count == limit) return false;
+            if (count++ > 0) body += ',';
+            if (txids_only) {
+                body += '"' + key.txhash.GetHex() + '"';
+                last = key.txhash;
+            } else {
+                UniValue delta(UniValue::VOBJ);
+                delta.pushKV("satoshis", amount);
+                delta.pushKV("txid", key.txhash.GetHex());
+                delta.pushKV("index", (int)key.index);
+                delta.pushKV("blockindex", (int)key.txindex);
+                delta.pushKV("height", key.blockHeight);
+                const auto it = std::find(addresses.begin(), addresses.end(), std::make_pair(key.hashBytes, (int)key.type));
+                delta.pushKV("address", address_strs[it - addresses.begin()]);
+                body += delta.write();
+            }
+            return true;
+        }, next);
+    if (!found) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read address index");
+    }
+    body += "],\"next\":";
+    body += next ? '"' + EncodeAddressCursor(*next) + '"' : std::string("null");
+    body += "}\n";
+
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, body);
+    return true;
+}
+
+static bool rest_address_deltas(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address_page(req, strURIPart, false);
+}
+
+static bool rest_address_txids(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address_page(req, strURIPart, true);
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(const std::any& context, HTTPRequest* req, const std::string& strReq);
@@ -721,6 +845,8 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/addressdeltas/", rest_address_deltas},
+      {"/rest/addresstxids/", rest_address_txids},
 };
 
 void StartREST(const std::any& context)
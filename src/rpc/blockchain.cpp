@@ -133,6 +133,25 @@ double GetDifficulty(const CBlockIndex* blockindex)
     return dDiff;
 }
 
+std::optional<int> ActiveChainFollower::Update(const CChain& chain)
+{
+    if (m_unloads != g_block_index_unloads) {
+        // m_tip may point into freed memory, or at a new entry in its place.
+        m_unloads = g_block_index_unloads;
+        m_tip = chain.Tip();
+        return 0;
+    }
+    if (chain.Tip() == m_tip) return std::nullopt;
+
+    int first = 0;
+    if (m_tip) {
+        const CBlockIndex* fork = chain.FindFork(m_tip);
+        first = fork ? fork->nHeight + 1 : 0;
+    }
+    m_tip = chain.Tip();
+    return first;
+}
+
 static int ComputeNextBlockAndDepth(const CBlockIndex* tip, const CBlockIndex* blockindex, const CBlockIndex*& next)
 {
     next = tip->GetAncestor(blockindex->nHeight + 1);
@@ -825,6 +844,54 @@ static RPCHelpMan getblockhash()
     };
 }
 
+static RPCHelpMan gettotalsupply()
+{
+    return RPCHelpMan{"gettotalsupply",
+                "\nReturns the amount issued by block subsidies up to a height of the best-block-chain.\n"
+                "This is the maximum supply at that height; fees and coinbase outputs left unclaimed are not subtracted.\n",
+                {
+                    {"height", RPCArg::Type::NUM, RPCArg::DefaultHint{"current tip"}, "The height index"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "height", "The height index"},
+                        {RPCResult::Type::STR_HEX, "blockhash", "The block hash at that height"},
+                        {RPCResult::Type::STR_AMOUNT, "subsidy", "The block subsidy at that height"},
+                        {RPCResult::Type::STR_AMOUNT, "totalsupply", "The total issued by the block subsidies of heights 0 to height"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("gettotalsupply", "")
+            + HelpExampleCli("gettotalsupply", "1000")
+            + HelpExampleRpc("gettotalsupply", "1000")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    int nHeight;
+    uint256 hash;
+    {
+        LOCK(cs_main);
+        const CChain& active_chain = chainman.ActiveChain();
+        nHeight = request.params[0].isNull() ? active_chain.Height() : request.params[0].get_int();
+        if (nHeight < 0 || nHeight > active_chain.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        hash = active_chain[nHeight]->GetBlockHash();
+    }
+
+    // The supply table may have to be filled up to the height, which is left
+    // to run without cs_main.
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("height", nHeight);
+    result.pushKV("blockhash", hash.GetHex());
+    result.pushKV("subsidy", ValueFromAmount(GetBlockSubsidy(nHeight, consensus_params)));
+    result.pushKV("totalsupply", ValueFromAmount(GetBlockSupply(nHeight, consensus_params)));
+    return result;
+},
+    };
+}
+
 static RPCHelpMan getblockheader()
 {
     return RPCHelpMan{"getblockheader",
@@ -912,6 +979,20 @@ static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
     return block;
 }
 
+static std::shared_ptr<const std::vector<uint8_t>> GetRawBlockChecked(const CBlockIndex* pblockindex)
+{
+    if (IsBlockPruned(pblockindex)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+    }
+
+    auto raw_block = ReadRawBlockCached(pblockindex, Params().MessageStart());
+    if (!raw_block) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    }
+
+    return raw_block;
+}
+
 static CBlockUndo GetUndoChecked(const CBlockIndex* pblockindex)
 {
     CBlockUndo blockUndo;
@@ -994,7 +1075,12 @@ static RPCHelpMan getblock()
         }
     }
 
+    // The block is serialized on disk as it is returned, unless witnesses
+    // are to be left out, so it can be returned without deserializing it.
+    const bool raw = verbosity <= 0 && !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+
     CBlock block;
+    std::shared_ptr<const std::vector<uint8_t>> raw_block;
     const CBlockIndex* pblockindex;
     const CBlockIndex* tip;
     {
@@ -1007,7 +1093,15 @@ static RPCHelpMan getblock()
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
         }
 
-        block = GetBlockChecked(pblockindex);
+        if (raw) {
+            raw_block = GetRawBlockChecked(pblockindex);
+        } else {
+            block = GetBlockChecked(pblockindex);
+        }
+    }
+
+    if (raw) {
+        return HexStr(*raw_block);
     }
 
     if (verbosity <= 0)
@@ -1162,6 +1256,8 @@ static RPCHelpMan gettxoutsetinfo()
     BlockManager* blockman;
     {
         LOCK(::cs_main);
+        // A flush from another thread may have gone to the background since.
+        active_chainstate.CoinsWriteBehind().Wait();
         coins_view = &active_chainstate.CoinsDB();
         blockman = &active_chainstate.m_blockman;
         pindex = blockman->LookupBlockIndex(coins_view->GetBestBlock());
@@ -1417,6 +1513,14 @@ RPCHelpMan getblockchaininfo()
                         {RPCResult::Type::NUM, "pruneheight", "lowest-height complete block stored (only present if pruning is enabled)"},
                         {RPCResult::Type::BOOL, "automatic_pruning", "whether automatic pruning is enabled (only present if pruning is enabled)"},
                         {RPCResult::Type::NUM, "prune_target_size", "the target size used by pruning (only present if automatic pruning is enabled)"},
+                        {RPCResult::Type::OBJ, "coins_flush", "background writes of the coins cache (only present if -coinswritebehind is enabled)",
+                        {
+                            {RPCResult::Type::NUM, "pending_coins", "the number of changed coins being written"},
+                            {RPCResult::Type::NUM, "writes", "the number of background writes completed"},
+                            {RPCResult::Type::NUM, "write_time", "the total time spent on background writes, in seconds"},
+                            {RPCResult::Type::NUM, "last_write_time", "the time the last background write took, in seconds"},
+                            {RPCResult::Type::NUM, "wait_time", "the total time spent waiting for background writes to finish, in seconds"},
+                        }},
                         {RPCResult::Type::OBJ_DYN, "softforks", "status of softforks",
                         {
                             {RPCResult::Type::OBJ, "xxxx", "name of the softfork",
@@ -1487,6 +1591,17 @@ RPCHelpMan getblockchaininfo()
         }
     }
 
+    const CoinsWriteBehindStats flush_stats = active_chainstate.CoinsWriteBehind().GetStats();
+    if (flush_stats.enabled) {
+        UniValue coins_flush(UniValue::VOBJ);
+        coins_flush.pushKV("pending_coins",   (uint64_t)flush_stats.pending_coins);
+        coins_flush.pushKV("writes",          flush_stats.writes);
+        coins_flush.pushKV("write_time",      CountSecondsDouble(flush_stats.write_time));
+        coins_flush.pushKV("last_write_time", CountSecondsDouble(flush_stats.last_write_time));
+        coins_flush.pushKV("wait_time",       CountSecondsDouble(flush_stats.wait_time));
+        obj.pushKV("coins_flush", coins_flush);
+    }
+
     const Consensus::Params& consensusParams = Params().GetConsensus();
     UniValue softforks(UniValue::VOBJ);
     SoftForkDescPushBack(tip, softforks, consensusParams, Consensus::DEPLOYMENT_TAPROOT);
@@ -2620,6 +2735,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         &getblock,                           },
     { "blockchain",         &getblockhash,                       },
     { "blockchain",         &getblockheader,                     },
+    { "blockchain",         &gettotalsupply,                     },
     { "blockchain",         &getchaintips,                       },
     { "blockchain",         &getdifficulty,                      },
     { "blockchain",         &getmempoolancestors,                },
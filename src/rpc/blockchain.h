@@ -11,6 +11,7 @@
 #include <sync.h>
 
 #include <any>
+#include <optional>
 #include <stdint.h>
 #include <vector>
 
@@ -18,6 +19,7 @@ extern RecursiveMutex cs_main;
 
 class CBlock;
 class CBlockIndex;
+class CChain;
 class CBlockPolicyEstimator;
 class CChainState;
 class CTxMemPool;
@@ -35,6 +37,27 @@ static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
  */
 double GetDifficulty(const CBlockIndex* blockindex);
 
+/**
+ * Follows the active chain on behalf of a cache of data by block height, and
+ * tells from which height on the cached data no longer matches the chain.
+ */
+class ActiveChainFollower
+{
+private:
+    const CBlockIndex* m_tip{nullptr};
+    //! Value of g_block_index_unloads when m_tip was set
+    uint64_t m_unloads{0};
+
+public:
+    /**
+     * Move to the tip of the active chain.
+     * @return the first height whose data has to be recomputed: one above the
+     * fork point with the previous tip, or 0 the first time and after the
+     * block index was unloaded; std::nullopt if the tip has not changed.
+     */
+    std::optional<int> Update(const CChain& chain) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+};
+
 /** Callback for when block tip changed. */
 void RPCNotifyBlockChange(const CBlockIndex*);
 
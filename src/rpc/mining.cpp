@@ -10,6 +10,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <crypto/common.h>
 #include <deploymentinfo.h>
 #include <deploymentstatus.h>
 #include <key_io.h>
@@ -33,28 +34,132 @@
 #include <util/strencodings.h>
 #include <util/string.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <validation.h>
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * Minimum and maximum block times over ranges of heights of the active chain.
+ * A sparse table over runs of RUN heights covers the whole runs in a range in
+ * O(1), and the at most 2 * RUN heights left at its ends are scanned. The
+ * table follows the active chain, recomputing only above the fork point.
+ */
+class BlockTimeRanges
+{
+private:
+    static constexpr int RUN = 64;
+
+    ActiveChainFollower m_follower;
+    //! Block times by height.
+    std::vector<uint32_t> m_times;
+    //! Minimum and maximum of the block times in the 2^k runs starting at a run, by k.
+    std::vector<std::vector<uint32_t>> m_min, m_max;
+
+    void Scan(int begin, int end, uint32_t& min_time, uint32_t& max_time) const
+    {
+        for (int height = begin; height <= end; ++height) {
+            min_time = std::min(min_time, m_times[height]);
+            max_time = std::max(max_time, m_times[height]);
+        }
+    }
+
+public:
+    /** Catch up with the active chain. */
+    void Update(const CChain& chain)
+    {
+        const std::optional<int> first = m_follower.Update(chain);
+        if (!first) return;
+
+        const size_t keep = std::min<size_t>(*first, m_times.size());
+        m_times.resize(keep);
+        for (int height = keep; height <= chain.Height(); ++height) {
+            m_times.push_back(chain[height]->nTime);
+        }
+
+        // Recompute the entries whose runs start at or above the first changed one.
+        const size_t runs = (m_times.size() + RUN - 1) / RUN;
+        const size_t changed = keep / RUN;
+        size_t level = 0;
+        for (size_t width = 1; width <= runs; width *= 2, ++level) {
+            if (level == m_min.size()) {
+                m_min.emplace_back();
+                m_max.emplace_back();
+            }
+            const size_t count = runs - width + 1;
+            m_min[level].resize(count);
+            m_max[level].resize(count);
+            for (size_t run = changed >= width ? changed - width + 1 : 0; run < count; ++run) {
+                if (level == 0) {
+                    uint32_t min_time = std::numeric_limits<uint32_t>::max(), max_time = 0;
+                    Scan(run * RUN, std::min(m_times.size(), (run + 1) * RUN) - 1, min_time, max_time);
+                    m_min[0][run] = min_time;
+                    m_max[0][run] = max_time;
+                } else {
+                    m_min[level][run] = std::min(m_min[level - 1][run], m_min[level - 1][run + width / 2]);
+                    m_max[level][run] = std::max(m_max[level - 1][run], m_max[level - 1][run + width / 2]);
+                }
+            }
+        }
+        m_min.resize(level);
+        m_max.resize(level);
+    }
+
+    /** The minimum and maximum block times at heights begin to end, inclusive. */
+    std::pair<int64_t, int64_t> MinMax(int begin, int end) const
+    {
+        uint32_t min_time = std::numeric_limits<uint32_t>::max(), max_time = 0;
+        const int first_run = begin / RUN + 1, last_run = end / RUN - 1;
+        if (first_run > last_run) {
+            Scan(begin, end, min_time, max_time);
+        } else {
+            Scan(begin, first_run * RUN - 1, min_time, max_time);
+            Scan((last_run + 1) * RUN, end, min_time, max_time);
+            const int level = CountBits(last_run - first_run + 1) - 1;
+            const int second = last_run - (1 << level) + 1;
+            min_time = std::min({min_time, m_min[level][first_run], m_min[level][second]});
+            max_time = std::max({max_time, m_max[level][first_run], m_max[level][second]});
+        }
+        return {min_time, max_time};
+    }
+};
+
+BlockTimeRanges g_block_time_ranges GUARDED_BY(cs_main);
+
+} // namespace
 
 /**
  * Return average network hashes per second based on the last 'lookup' blocks,
  * or from the last difficulty change if 'lookup' is nonpositive.
  * If 'height' is nonnegative, compute the estimate at the time when a given block was found.
+ * Sets 'lookup' and 'height' to the window actually used.
  */
-static UniValue GetNetworkHashPS(int lookup, int height, const CChain& active_chain) {
+static double GetNetworkHashPS(int& lookup, int& height, const CChain& active_chain) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
     const CBlockIndex* pb = active_chain.Tip();
 
     if (height >= 0 && height < active_chain.Height()) {
         pb = active_chain[height];
     }
+    height = pb ? pb->nHeight : -1;
 
-    if (pb == nullptr || !pb->nHeight)
+    if (pb == nullptr || !pb->nHeight) {
+        lookup = 0;
         return 0;
+    }
 
     // If lookup is -1, then use blocks since last difficulty change.
     if (lookup <= 0)
@@ -64,15 +169,9 @@ static UniValue GetNetworkHashPS(int lookup, int height, const CChain& active_ch
     if (lookup > pb->nHeight)
         lookup = pb->nHeight;
 
-    const CBlockIndex* pb0 = pb;
-    int64_t minTime = pb0->GetBlockTime();
-    int64_t maxTime = minTime;
-    for (int i = 0; i < lookup; i++) {
-        pb0 = pb0->pprev;
-        int64_t time = pb0->GetBlockTime();
-        minTime = std::min(time, minTime);
-        maxTime = std::max(time, maxTime);
-    }
+    const CBlockIndex* pb0 = active_chain[pb->nHeight - lookup];
+    g_block_time_ranges.Update(active_chain);
+    const auto [minTime, maxTime] = g_block_time_ranges.MinMax(pb0->nHeight, pb->nHeight);
 
     // In case there's a situation where minTime == maxTime, we don't want a divide by zero exception.
     if (minTime == maxTime)
@@ -104,12 +203,155 @@ static RPCHelpMan getnetworkhashps()
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
     LOCK(cs_main);
-    return GetNetworkHashPS(!request.params[0].isNull() ? request.params[0].get_int() : 120, !request.params[1].isNull() ? request.params[1].get_int() : -1, chainman.ActiveChain());
+    int lookup = !request.params[0].isNull() ? request.params[0].get_int() : 120;
+    int height = !request.params[1].isNull() ? request.params[1].get_int() : -1;
+    return GetNetworkHashPS(lookup, height, chainman.ActiveChain());
 },
     };
 }
 
-static bool GenerateBlock(ChainstateManager& chainman, CBlock& block, uint64_t& max_tries, unsigned int& extra_nonce, uint256& block_hash)
+/** Windows getnetworkhashpsseries accepts in one call. */
+static const size_t MAX_HASHPS_WINDOWS = 100000;
+
+static RPCHelpMan getnetworkhashpsseries()
+{
+    return RPCHelpMan{"getnetworkhashpsseries",
+                "\nReturns the estimated network hashes per second over several windows of blocks at once,\n"
+                "each as getnetworkhashps would for its nblocks and height.\n",
+                {
+                    {"windows", RPCArg::Type::ARR, RPCArg::Optional::NO, "The windows, at most " + ToString(MAX_HASHPS_WINDOWS),
+                        {
+                            {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                                {
+                                    {"nblocks", RPCArg::Type::NUM, RPCArg::Default{120}, "The number of blocks, or -1 for blocks since last difficulty change."},
+                                    {"height", RPCArg::Type::NUM, RPCArg::Default{-1}, "To estimate at the time of the given height."},
+                                },
+                            },
+                        },
+                    },
+                },
+                RPCResult{
+                    RPCResult::Type::ARR, "", "The estimates, in the order of the windows",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "nblocks", "The number of blocks used"},
+                            {RPCResult::Type::NUM, "height", "The height estimated at"},
+                            {RPCResult::Type::NUM, "hashps", "Hashes per second estimated"},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getnetworkhashpsseries", "'[{\"nblocks\":1440,\"height\":100000},{\"nblocks\":1440,\"height\":101440}]'")
+            + HelpExampleRpc("getnetworkhashpsseries", "[{\"nblocks\":1440,\"height\":100000},{\"nblocks\":1440,\"height\":101440}]")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const UniValue& windows = request.params[0].get_array();
+    if (windows.size() > MAX_HASHPS_WINDOWS) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Too many windows, at most %u", MAX_HASHPS_WINDOWS));
+    }
+    for (size_t i = 0; i < windows.size(); ++i) {
+        RPCTypeCheckObj(windows[i], {
+            {"nblocks", UniValueType(UniValue::VNUM)},
+            {"height", UniValueType(UniValue::VNUM)},
+        }, true, true);
+    }
+
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    LOCK(cs_main);
+    UniValue result(UniValue::VARR);
+    for (size_t i = 0; i < windows.size(); ++i) {
+        const UniValue& window = windows[i];
+        int lookup = !window["nblocks"].isNull() ? window["nblocks"].get_int() : 120;
+        int height = !window["height"].isNull() ? window["height"].get_int() : -1;
+        const double hashps = GetNetworkHashPS(lookup, height, chainman.ActiveChain());
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("nblocks", lookup);
+        entry.pushKV("height", height);
+        entry.pushKV("hashps", hashps);
+        result.push_back(entry);
+    }
+    return result;
+},
+    };
+}
+
+/** Nonces GenerateBlock hands out to a thread at a time; short, to notice a shutdown request in time. */
+static const uint32_t NONCES_PER_SWEEP = 64;
+
+/**
+ * Search the nonces of block from block.nNonce up for one whose work hash is at
+ * or below target, on threads threads. Runs of NONCES_PER_SWEEP nonces are
+ * handed out in order and every run started is finished, so the nonce found is
+ * the first one that qualifies, the same as on a single thread.
+ *
+ * Stops after max_tries nonces, before the nonce reaches its maximum, or on
+ * shutdown. Advances block.nNonce and max_tries past the nonces tried, leaving
+ * block.nNonce at the qualifying one, if any.
+ */
+static void SweepBlockNonces(CBlock& block, const arith_uint256& target, uint64_t& max_tries, int threads)
+{
+    const uint32_t start = block.nNonce;
+    const uint64_t total = std::min<uint64_t>(max_tries, std::numeric_limits<uint32_t>::max() - start);
+    if (target == 0) {
+        // No hash can qualify, so hash nothing.
+        block.nNonce += total;
+        max_tries -= total;
+        return;
+    }
+
+    const CBlockHeaderUncached header = block;
+    std::atomic<uint64_t> next_run{0};
+    std::atomic<uint64_t> found{total};
+    std::atomic<bool> abort{false};
+    const auto sweep = [&] {
+        while (found == total && !abort && !ShutdownRequested()) {
+            const uint64_t offset = next_run.fetch_add(NONCES_PER_SWEEP);
+            if (offset >= total) break;
+            const uint32_t count = std::min<uint64_t>(NONCES_PER_SWEEP, total - offset);
+            if (const std::optional<uint32_t> nonce = SweepNonces(header, target, start + offset, count)) {
+                uint64_t tried = *nonce - start;
+                uint64_t prev = found;
+                while (tried < prev && !found.compare_exchange_weak(prev, tried)) {}
+            }
+        }
+    };
+
+    {
+        // Joins the workers however this block is left. If it is left by an
+        // exception, from this thread's sweep or from starting a worker, the
+        // workers stop at the end of their current run instead.
+        struct Workers {
+            std::atomic<bool>& abort;
+            std::vector<std::thread> threads;
+            ~Workers()
+            {
+                if (std::uncaught_exceptions() > 0) abort = true;
+                for (std::thread& thread : threads) thread.join();
+            }
+        } workers{abort, {}};
+        for (int i = 1; i < threads; ++i) {
+            workers.threads.emplace_back(&util::TraceThread, "generate", sweep);
+        }
+        sweep();
+    }
+
+    const uint64_t tried = std::min<uint64_t>(found, next_run);
+    block.nNonce += tried;
+    max_tries -= tried;
+}
+
+/** The number of threads a generate RPC searches nonces on: the threads argument, if given, else -genthreads. */
+static int GetGenerateThreads(const UniValue& param)
+{
+    const int64_t threads{param.isNull() ? gArgs.GetArg("-genthreads", DEFAULT_GENERATE_THREADS) : param.get_int()};
+    if (threads < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of threads, must be at least 0");
+    }
+    return std::min<int64_t>(threads == 0 ? GetNumCores() : threads, MAX_GENERATE_THREADS);
+}
+
+static bool GenerateBlock(ChainstateManager& chainman, CBlock& block, uint64_t& max_tries, unsigned int& extra_nonce, uint256& block_hash, int threads)
 {
     block_hash.SetNull();
 
@@ -118,12 +360,16 @@ static bool GenerateBlock(ChainstateManager& chainman, CBlock& block, uint64_t&
         IncrementExtraNonce(&block, chainman.ActiveChain().Tip(), extra_nonce);
     }
 
-    CChainParams chainparams(Params());
+    const CChainParams& chainparams(Params());
 
-    while (max_tries > 0 && block.nNonce < std::numeric_limits<uint32_t>::max() && !CheckProofOfWork(block.GetWorkHash(), block.nBits, chainparams.GetConsensus()) && !ShutdownRequested()) {
-        ++block.nNonce;
-        --max_tries;
+    arith_uint256 target;
+    bool neg, over;
+    target.SetCompact(block.nBits, &neg, &over);
+    if (neg || target == 0 || over || target > UintToArith256(chainparams.GetConsensus().powLimit)) {
+        // Out of range, so no hash passes CheckProofOfWork().
+        target = 0;
     }
+    SweepBlockNonces(block, target, max_tries, threads);
     if (max_tries == 0 || ShutdownRequested()) {
         return false;
     }
@@ -140,7 +386,7 @@ static bool GenerateBlock(ChainstateManager& chainman, CBlock& block, uint64_t&
     return true;
 }
 
-static UniValue generateBlocks(ChainstateManager& chainman, const CTxMemPool& mempool, const CScript& coinbase_script, int nGenerate, uint64_t nMaxTries)
+static UniValue generateBlocks(ChainstateManager& chainman, const CTxMemPool& mempool, const CScript& coinbase_script, int nGenerate, uint64_t nMaxTries, int threads)
 {
     int nHeightEnd = 0;
     int nHeight = 0;
@@ -160,7 +406,7 @@ static UniValue generateBlocks(ChainstateManager& chainman, const CTxMemPool& me
         CBlock *pblock = &pblocktemplate->block;
 
         uint256 block_hash;
-        if (!GenerateBlock(chainman, *pblock, nMaxTries, nExtraNonce, block_hash)) {
+        if (!GenerateBlock(chainman, *pblock, nMaxTries, nExtraNonce, block_hash, threads)) {
             break;
         }
 
@@ -215,6 +461,7 @@ static RPCHelpMan generatetodescriptor()
             {"num_blocks", RPCArg::Type::NUM, RPCArg::Optional::NO, "How many blocks are generated immediately."},
             {"descriptor", RPCArg::Type::STR, RPCArg::Optional::NO, "The descriptor to send the newly generated micro to."},
             {"maxtries", RPCArg::Type::NUM, RPCArg::Default{DEFAULT_MAX_TRIES}, "How many iterations to try."},
+            {"threads", RPCArg::Type::NUM, RPCArg::DefaultHint{"-genthreads"}, "How many threads to search nonces on, 0 for one per core."},
         },
         RPCResult{
             RPCResult::Type::ARR, "", "hashes of blocks generated",
@@ -228,6 +475,7 @@ static RPCHelpMan generatetodescriptor()
 {
     const int num_blocks{request.params[0].get_int()};
     const uint64_t max_tries{request.params[2].isNull() ? DEFAULT_MAX_TRIES : request.params[2].get_int()};
+    const int threads{GetGenerateThreads(request.params[3])};
 
     CScript coinbase_script;
     std::string error;
@@ -239,7 +487,7 @@ static RPCHelpMan generatetodescriptor()
     const CTxMemPool& mempool = EnsureMemPool(node);
     ChainstateManager& chainman = EnsureChainman(node);
 
-    return generateBlocks(chainman, mempool, coinbase_script, num_blocks, max_tries);
+    return generateBlocks(chainman, mempool, coinbase_script, num_blocks, max_tries, threads);
 },
     };
 }
@@ -259,6 +507,7 @@ static RPCHelpMan generatetoaddress()
                     {"nblocks", RPCArg::Type::NUM, RPCArg::Optional::NO, "How many blocks are generated immediately."},
                     {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address to send the newly generated micro to."},
                     {"maxtries", RPCArg::Type::NUM, RPCArg::Default{DEFAULT_MAX_TRIES}, "How many iterations to try."},
+                    {"threads", RPCArg::Type::NUM, RPCArg::DefaultHint{"-genthreads"}, "How many threads to search nonces on, 0 for one per core."},
                 },
                 RPCResult{
                     RPCResult::Type::ARR, "", "hashes of blocks generated",
@@ -275,6 +524,7 @@ static RPCHelpMan generatetoaddress()
 {
     const int num_blocks{request.params[0].get_int()};
     const uint64_t max_tries{request.params[2].isNull() ? DEFAULT_MAX_TRIES : request.params[2].get_int()};
+    const int threads{GetGenerateThreads(request.params[3])};
 
     CTxDestination destination = DecodeDestination(request.params[1].get_str());
     if (!IsValidDestination(destination)) {
@@ -287,7 +537,7 @@ static RPCHelpMan generatetoaddress()
 
     CScript coinbase_script = GetScriptForDestination(destination);
 
-    return generateBlocks(chainman, mempool, coinbase_script, num_blocks, max_tries);
+    return generateBlocks(chainman, mempool, coinbase_script, num_blocks, max_tries, threads);
 },
     };
 }
@@ -305,6 +555,7 @@ static RPCHelpMan generateblock()
                     {"rawtx/txid", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, ""},
                 },
             },
+            {"threads", RPCArg::Type::NUM, RPCArg::DefaultHint{"-genthreads"}, "How many threads to search nonces on, 0 for one per core."},
         },
         RPCResult{
             RPCResult::Type::OBJ, "", "",
@@ -319,6 +570,7 @@ static RPCHelpMan generateblock()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     const auto address_or_descriptor = request.params[0].get_str();
+    const int threads{GetGenerateThreads(request.params[2])};
     CScript coinbase_script;
     std::string error;
 
@@ -358,7 +610,7 @@ static RPCHelpMan generateblock()
         }
     }
 
-    CChainParams chainparams(Params());
+    const CChainParams& chainparams(Params());
     CBlock block;
 
     ChainstateManager& chainman = EnsureChainman(node);
@@ -392,7 +644,7 @@ static RPCHelpMan generateblock()
     uint64_t max_tries{DEFAULT_MAX_TRIES};
     unsigned int extra_nonce{0};
 
-    if (!GenerateBlock(chainman, block, max_tries, extra_nonce, block_hash) || block_hash.IsNull()) {
+    if (!GenerateBlock(chainman, block, max_tries, extra_nonce, block_hash, threads) || block_hash.IsNull()) {
         throw JSONRPCError(RPC_MISC_ERROR, "Failed to make block.");
     }
 
@@ -1253,6 +1505,7 @@ static const CRPCCommand commands[] =
 { //  category               actor (function)
   //  ---------------------  -----------------------
     { "mining",              &getnetworkhashps,        },
+    { "mining",              &getnetworkhashpsseries,  },
     { "mining",              &getmininginfo,           },
     { "mining",              &prioritisetransaction,   },
     { "mining",              &getblocktemplate,        },
@@ -7,5 +7,9 @@
 
 /** Default max iterations to try in RPC generatetodescriptor, generatetoaddress, and generateblock. */
 static const uint64_t DEFAULT_MAX_TRIES{1000000};
+/** Default for -genthreads, the threads those RPCs search nonces on. */
+static const int DEFAULT_GENERATE_THREADS{1};
+/** Most threads those RPCs search nonces on. */
+static const int MAX_GENERATE_THREADS{64};
 
 #endif // MICRO_RPC_MINING_H
@@ -3,7 +3,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <crypto/yespower/yespower.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
 #include <index/txindex.h>
@@ -27,8 +29,10 @@
 #include <txmempool.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <stdint.h>
 #include <tuple>
+#include <vector>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
 #endif
@@ -458,6 +462,23 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCYespowerMemoryInfo()
+{
+    const YespowerScratchpadStats stats = YespowerScratchpadsStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("scratchpads", uint64_t(stats.total));
+    obj.pushKV("scratchpads_used", uint64_t(stats.in_use));
+    obj.pushKV("scratchpads_max", uint64_t(stats.max));
+    obj.pushKV("total", uint64_t(stats.bytes));
+    obj.pushKV("hugetlb", uint64_t(stats.hugetlb_bytes));
+    obj.pushKV("thp", uint64_t(stats.thp_bytes));
+    obj.pushKV("numa_nodes", uint64_t(stats.numa_nodes));
+    obj.pushKV("temporary", stats.temporary);
+    obj.pushKV("remote", stats.remote);
+    obj.pushKV("waits", stats.waits);
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -502,6 +523,19 @@ static RPCHelpMan getmemoryinfo()
                                 {RPCResult::Type::NUM, "chunks_used", "Number allocated chunks"},
                                 {RPCResult::Type::NUM, "chunks_free", "Number unused chunks"},
                             }},
+                            {RPCResult::Type::OBJ, "yespower", "Information about the scratchpads proof-of-work hashes are computed in",
+                            {
+                                {RPCResult::Type::NUM, "scratchpads", "Number of scratchpads allocated"},
+                                {RPCResult::Type::NUM, "scratchpads_used", "Number of scratchpads a thread is hashing with"},
+                                {RPCResult::Type::NUM, "scratchpads_max", "Most scratchpads there may be (see -powscratchpads), 0 for no limit"},
+                                {RPCResult::Type::NUM, "total", "Total number of bytes mapped for the scratchpads"},
+                                {RPCResult::Type::NUM, "hugetlb", "Of which on explicitly reserved huge pages"},
+                                {RPCResult::Type::NUM, "thp", "Of which advised to use transparent huge pages"},
+                                {RPCResult::Type::NUM, "numa_nodes", "Number of NUMA nodes the scratchpads are on"},
+                                {RPCResult::Type::NUM, "temporary", "Times a thread hashed in a temporary scratchpad, as all of them were in use"},
+                                {RPCResult::Type::NUM, "remote", "Times a thread borrowed a scratchpad on another NUMA node"},
+                                {RPCResult::Type::NUM, "waits", "Times a thread waited for a scratchpad, as all of them were in use"},
+                            }},
                         }
                     },
                     RPCResult{"mode \"mallocinfo\"",
@@ -518,6 +552,7 @@ static RPCHelpMan getmemoryinfo()
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("yespower", RPCYespowerMemoryInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -740,6 +775,10 @@ static RPCHelpMan getindexinfo()
         result.pushKVs(SummaryToJSON(g_coin_stats_index->GetSummary(), index_name));
     }
 
+    if (g_address_index) {
+        result.pushKVs(SummaryToJSON(g_address_index->GetSummary(), index_name));
+    }
+
     ForEachBlockFilterIndex([&result, &index_name](const BlockFilterIndex& index) {
         result.pushKVs(SummaryToJSON(index.GetSummary(), index_name));
     });
@@ -751,6 +790,17 @@ static RPCHelpMan getindexinfo()
 
 
 
+static const AddressIndex& EnsureAddressIndex()
+{
+    if (!g_address_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled");
+    }
+    if (!g_address_index->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still in the process of being synced");
+    }
+    return *g_address_index;
+}
+
 bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint256, int> > &addresses)
 {
     if (params[0].isStr()) {
@@ -790,11 +840,6 @@ bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
     return a.second.blockHeight < b.second.blockHeight;
 }
 
-bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
-                   std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> b) {
-    return a.second.time < b.second.time;
-}
-
 bool getAddressFromIndex(const int &type, const uint256 &hash, std::string &address)
 {
     if (type == 2) {
@@ -814,6 +859,56 @@ bool getAddressFromIndex(const int &type, const uint256 &hash, std::string &addr
     return true;
 }
 
+static UniValue AddressDeltaToJSON(const CAddressIndexKey& key, CAmount amount)
+{
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.pushKV("satoshis", amount);
+    delta.pushKV("txid", key.txhash.GetHex());
+    delta.pushKV("index", (int)key.index);
+    delta.pushKV("blockindex", (int)key.txindex);
+    delta.pushKV("height", key.blockHeight);
+    delta.pushKV("address", address);
+    return delta;
+}
+
+/**
+ * Read the limit and cursor options of an address query. Returns false if
+ * neither is given, in which case the whole history is returned at once.
+ */
+static bool ParseAddressPage(const UniValue& params, const std::vector<std::pair<uint256, int> >& addresses,
+                             size_t& limit, std::optional<CAddressIndexKey>& from)
+{
+    if (!params[0].isObject()) {
+        return false;
+    }
+    const UniValue& limitValue = find_value(params[0].get_obj(), "limit");
+    const UniValue& cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull() && cursorValue.isNull()) {
+        return false;
+    }
+    limit = MAX_ADDRESS_PAGE_SIZE;
+    if (!limitValue.isNull()) {
+        const int n = limitValue.get_int();
+        if (n <= 0 || (size_t)n > MAX_ADDRESS_PAGE_SIZE) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("limit is expected to be between 1 and %u", MAX_ADDRESS_PAGE_SIZE));
+        }
+        limit = n;
+    }
+    if (!cursorValue.isNull()) {
+        CAddressIndexKey key;
+        if (!DecodeAddressCursor(cursorValue.get_str(), addresses, key)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        from = key;
+    }
+    return true;
+}
+
 RPCHelpMan getaddressdeltas()
 {
     return RPCHelpMan{"getaddressdeltas",
@@ -821,7 +916,7 @@ RPCHelpMan getaddressdeltas()
             {
                 {"argument", RPCArg::Type::OBJ, RPCArg::Optional::NO, "Json object",
                     {
-                        {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The qtum addresses",
+                        {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The qtum addresses (max " + ToString(MAX_ADDRESS_QUERY_SIZE) + ")",
                             {
                                 {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The qtum address"},
                             }
@@ -829,24 +924,36 @@ RPCHelpMan getaddressdeltas()
                         {"start", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "The start block height"},
                         {"end", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "The end block height"},
                         {"chainInfo", RPCArg::Type::BOOL, RPCArg::Optional::OMITTED_NAMED_ARG, "Include chain info in results, only applies if start and end specified"},
+                        {"limit", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "Return at most this many deltas, in height order (max " + ToString(MAX_ADDRESS_PAGE_SIZE) + ")"},
+                        {"cursor", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "Resume a paginated query at the \"next\" cursor it returned"},
                     }
                 }
             },
-            RPCResult{
-                RPCResult::Type::OBJ, "", "",
-                {
-                    {RPCResult::Type::NUM, "satoshis", "The difference of satoshis"},
-                    {RPCResult::Type::STR_HEX, "txid", "The related txid"},
-                    {RPCResult::Type::NUM, "index", "The related input or output index"},
-                    {RPCResult::Type::NUM, "height", "The block height"},
-                    {RPCResult::Type::STR, "address", "The qtum address"},
-                }
+            {
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "satoshis", "The difference of satoshis"},
+                        {RPCResult::Type::STR_HEX, "txid", "The related txid"},
+                        {RPCResult::Type::NUM, "index", "The related input or output index"},
+                        {RPCResult::Type::NUM, "height", "The block height"},
+                        {RPCResult::Type::STR, "address", "The qtum address"},
+                    }
+                },
+                RPCResult{"if limit or cursor is given",
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::ARR, "deltas", "The deltas of this page, as above", {{RPCResult::Type::ELISION, "", ""}}},
+                        {RPCResult::Type::STR, "next", /* optional */ true, "Cursor of the next page, or null after the last page"},
+                    }
+                },
             },
             RPCExamples{
                 HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"]}'")
         + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"]}") +
                 HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"start\": 5000, \"end\": 5500, \"chainInfo\": true}'")
-        + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"start\": 5000, \"end\": 5500, \"chainInfo\": true}")
+        + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"start\": 5000, \"end\": 5500, \"chainInfo\": true}") +
+                HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"limit\": 1000}'")
             },
     [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
@@ -879,37 +986,31 @@ RPCHelpMan getaddressdeltas()
     if (!getAddressesFromParams(request.params, addresses)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
-
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
+    if (addresses.size() > MAX_ADDRESS_QUERY_SIZE) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("At most %u addresses can be queried at once", MAX_ADDRESS_QUERY_SIZE));
     }
 
-    UniValue deltas(UniValue::VARR);
+    size_t limit = 0;
+    std::optional<CAddressIndexKey> from;
+    const bool paged = ParseAddressPage(request.params, addresses, limit, from);
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
+    UniValue deltas(UniValue::VARR);
+    std::optional<CAddressIndexKey> next;
+    const bool found = EnsureAddressIndex().MergeAddressDeltas(addresses, start, end, from ? &*from : nullptr,
+        [&](const CAddressIndexKey& key, CAmount amount) {
+            if (paged && deltas.size() == limit) return false;
+            deltas.push_back(AddressDeltaToJSON(key, amount));
+            return true;
+        }, next);
+    if (!found) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
 
-        UniValue delta(UniValue::VOBJ);
-        delta.pushKV("satoshis", it->second);
-        delta.pushKV("txid", it->first.txhash.GetHex());
-        delta.pushKV("index", (int)it->first.index);
-        delta.pushKV("blockindex", (int)it->first.txindex);
-        delta.pushKV("height", it->first.blockHeight);
-        delta.pushKV("address", address);
-        deltas.push_back(delta);
+    if (paged) {
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("deltas", deltas);
+        result.pushKV("next", next ? UniValue(EncodeAddressCursor(*next)) : NullUniValue);
+        return result;
     }
 
     UniValue result(UniValue::VOBJ);
@@ -982,26 +1083,17 @@ RPCHelpMan getaddressbalance()
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
+    const AddressIndex& address_index = EnsureAddressIndex();
     CAmount balance = 0;
     CAmount received = 0;
 
-    ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
-    CChain& active_chain = chainman.ActiveChain();
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAddressBalanceValue addressBalance;
+        if (!address_index.FindAddressBalance((*it).first, (*it).second, addressBalance)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
-        int nHeight = active_chain.Height();
+        balance += addressBalance.balance;
+        received += addressBalance.received;
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1065,12 +1157,12 @@ RPCHelpMan getaddressutxos()
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
+    if (!EnsureAddressIndex().FindAddressUnspent(addresses, unspentOutputs)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
+    // The unspent index is keyed by outpoint, not height, so unlike the
+    // deltas there is no ordered iterator to merge the addresses with.
     std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
 
     UniValue utxos(UniValue::VARR);
@@ -1155,8 +1247,6 @@ RPCHelpMan getaddressmempool()
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
-    std::sort(indexes.begin(), indexes.end(), timestampSort);
-
     UniValue result(UniValue::VARR);
 
     for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::iterator it = indexes.begin();
@@ -1185,16 +1275,100 @@ RPCHelpMan getaddressmempool()
     };
 }
 
+namespace {
+
+/**
+ * Logical timestamps of the blocks of the active chain, for getblockhashes. A
+ * block's logical timestamp is its time, or one more than its parent's when
+ * that is not earlier, so they increase strictly with height and a time range
+ * is a height range found by binary search. Only the logical timestamps of
+ * every RUN-th height are kept; the others are recomputed from the block
+ * times on the way. The checkpoints follow the active chain, recomputing
+ * only above the fork point.
+ */
+class LogicalBlockTimes
+{
+private:
+    static constexpr int RUN = 64;
+
+    ActiveChainFollower m_follower;
+    //! Height and logical timestamp of the tip.
+    int m_height{-1};
+    uint32_t m_tip_time{0};
+    //! Logical timestamps of heights 0, RUN, 2 * RUN and so on.
+    std::vector<uint32_t> m_checkpoints;
+
+    static uint32_t Next(uint32_t prev_time, const CBlockIndex* pindex)
+    {
+        return pindex->nTime > prev_time ? pindex->nTime : prev_time + 1;
+    }
+
+public:
+    /** Catch up with the active chain. */
+    void Update(const CChain& chain)
+    {
+        const std::optional<int> first = m_follower.Update(chain);
+        if (!first) return;
+
+        int height = -1;
+        uint32_t time = 0;
+        if (*first > m_height) {
+            // The chain was only extended: continue from the previous tip.
+            height = m_height;
+            time = m_tip_time;
+        } else {
+            m_checkpoints.resize(*first > 0 ? (*first - 1) / RUN + 1 : 0);
+            if (!m_checkpoints.empty()) {
+                height = (m_checkpoints.size() - 1) * RUN;
+                time = m_checkpoints.back();
+            }
+        }
+        while (height < chain.Height()) {
+            ++height;
+            time = height == 0 ? chain[0]->nTime : Next(time, chain[height]);
+            if (height % RUN == 0) m_checkpoints.push_back(time);
+        }
+        m_height = height;
+        m_tip_time = time;
+    }
+
+    /** The blocks with low <= logical timestamp < high, with their logical timestamps. */
+    std::vector<std::pair<uint256, unsigned int>> Find(const CChain& chain, uint32_t high, uint32_t low) const
+    {
+        std::vector<std::pair<uint256, unsigned int>> hashes;
+        if (m_checkpoints.empty() || low >= high) return hashes;
+
+        // Start at the last checkpoint before low, or at the genesis block.
+        size_t run = std::lower_bound(m_checkpoints.begin(), m_checkpoints.end(), low) - m_checkpoints.begin();
+        if (run > 0) --run;
+        int height = run * RUN;
+        uint32_t time = m_checkpoints[run];
+        while (true) {
+            if (time >= high) break;
+            if (time >= low) hashes.emplace_back(chain[height]->GetBlockHash(), time);
+            if (height == chain.Height()) break;
+            ++height;
+            time = Next(time, chain[height]);
+        }
+        return hashes;
+    }
+};
+
+LogicalBlockTimes g_logical_block_times GUARDED_BY(cs_main);
+
+} // namespace
+
 RPCHelpMan getblockhashes()
 {
     return RPCHelpMan{"getblockhashes",
-                "\nReturns array of hashes of blocks within the timestamp range provided.\n",
+                "\nReturns array of hashes of blocks within the timestamp range provided.\n"
+                "Only blocks of the active chain are included, and -addressindex is not required.\n",
                 {
                     {"high", RPCArg::Type::NUM, RPCArg::Optional::NO, "The newer block timestamp"},
                     {"low", RPCArg::Type::NUM, RPCArg::Optional::NO, "The older block timestamp"},
                     {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "An object with options",
                         {
-                            {"noOrphans", RPCArg::Type::BOOL, RPCArg::Default{"false"}, "Will only include blocks on the main chain"},
+                            {"noOrphans", RPCArg::Type::BOOL, RPCArg::Default{"false"}, "Ignored: only blocks on the active chain are included"},
                             {"logicalTimes", RPCArg::Type::BOOL, RPCArg::Default{"false"}, "Will include logical timestamps with hashes"},
                         },
                     },
@@ -1225,29 +1399,23 @@ RPCHelpMan getblockhashes()
 
     unsigned int high = request.params[0].get_int();
     unsigned int low = request.params[1].get_int();
-    bool fActiveOnly = false;
     bool fLogicalTS = false;
 
     if (request.params.size() > 2) {
         if (request.params[2].isObject()) {
-            UniValue noOrphans = find_value(request.params[2].get_obj(), "noOrphans");
             UniValue returnLogical = find_value(request.params[2].get_obj(), "logicalTimes");
 
-            if (noOrphans.isBool())
-                fActiveOnly = noOrphans.get_bool();
-
             if (returnLogical.isBool())
                 fLogicalTS = returnLogical.get_bool();
         }
     }
 
     std::vector<std::pair<uint256, unsigned int> > blockHashes;
-    bool found = false;
-
-    found = GetTimestampIndex(high, low, fActiveOnly, blockHashes, chainman);
-
-    if (!found) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
+    {
+        LOCK(cs_main);
+        const CChain& active_chain = chainman.ActiveChain();
+        g_logical_block_times.Update(active_chain);
+        blockHashes = g_logical_block_times.Find(active_chain, high, low);
     }
 
     UniValue result(UniValue::VARR);
@@ -1309,7 +1477,7 @@ RPCHelpMan getspentinfo()
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
-    if (!GetSpentIndex(key, value, mempool)) {
+    if (!mempool.getSpentIndex(key, value) && !EnsureAddressIndex().FindSpentInfo(key, value)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
     }
 
@@ -1330,21 +1498,32 @@ RPCHelpMan getaddresstxids()
                 {
                     {"argument", RPCArg::Type::OBJ, RPCArg::Optional::NO, "Json object",
                         {
-                            {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The qtum addresses",
+                            {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The qtum addresses (max " + ToString(MAX_ADDRESS_QUERY_SIZE) + ")",
                                 {
                                     {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The qtum address"},
                                 }
                             },
                             {"start", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "The start block height"},
                             {"end", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "The end block height"},
+                            {"limit", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "Return at most this many txids, in height order (max " + ToString(MAX_ADDRESS_PAGE_SIZE) + ")"},
+                            {"cursor", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "Resume a paginated query at the \"next\" cursor it returned"},
                         }
                     }
                 },
-                RPCResult{
-                    RPCResult::Type::OBJ, "", "",
-                    {
-                        {RPCResult::Type::STR_HEX, "transactionid", "The transaction id"},
-                    }
+                {
+                    RPCResult{
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR_HEX, "transactionid", "The transaction id"},
+                        }
+                    },
+                    RPCResult{"if limit or cursor is given",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::ARR, "txids", "The txids of this page", {{RPCResult::Type::STR_HEX, "transactionid", "The transaction id"}}},
+                            {RPCResult::Type::STR, "next", /* optional */ true, "Cursor of the next page, or null after the last page"},
+                        }
+                    },
                 },
                 RPCExamples{
                     HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"]}'")
@@ -1360,6 +1539,9 @@ RPCHelpMan getaddresstxids()
     if (!getAddressesFromParams(request.params, addresses)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
+    if (addresses.size() > MAX_ADDRESS_QUERY_SIZE) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("At most %u addresses can be queried at once", MAX_ADDRESS_QUERY_SIZE));
+    }
 
     int start = 0;
     int end = 0;
@@ -1372,42 +1554,39 @@ RPCHelpMan getaddresstxids()
         }
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
+    if (start <= 0 || end <= 0) {
+        start = end = 0;
     }
 
-    std::set<std::pair<int, std::string> > txids;
-    UniValue result(UniValue::VARR);
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        int height = it->first.blockHeight;
-        std::string txid = it->first.txhash.GetHex();
-
-        if (addresses.size() > 1) {
-            txids.insert(std::make_pair(height, txid));
-        } else {
-            if (txids.insert(std::make_pair(height, txid)).second) {
-                result.push_back(txid);
-            }
-        }
+    size_t limit = 0;
+    std::optional<CAddressIndexKey> from;
+    const bool paged = ParseAddressPage(request.params, addresses, limit, from);
+
+    // All the deltas of a transaction are adjacent in the merged order, so
+    // each txid is seen once and a page ends before the first delta of the
+    // transaction past the limit.
+    UniValue txids(UniValue::VARR);
+    std::optional<CAddressIndexKey> next;
+    uint256 last;
+    const bool found = EnsureAddressIndex().MergeAddressDeltas(addresses, start, end, from ? &*from : nullptr,
+        [&](const CAddressIndexKey& key, CAmount amount) {
+            if (key.txhash == last) return true;
+            if (paged && txids.size() == limit) return false;
+            txids.push_back(key.txhash.GetHex());
+            last = key.txhash;
+            return true;
+        }, next);
+    if (!found) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
-    if (addresses.size() > 1) {
-        for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
-            result.push_back(it->second);
-        }
+    if (!paged) {
+        return txids;
     }
 
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("txids", txids);
+    result.pushKV("next", next ? UniValue(EncodeAddressCursor(*next)) : NullUniValue);
     return result;
 },
     };
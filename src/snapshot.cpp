@@ -11,9 +11,21 @@
 #include <support/httplib.h>
 #include <support/csv.h>
 #include <core_io.h>
+#include <crypto/common.h>
+#include <hash.h>
+#include <cstring>
 #include <random>
 #include <fs.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const unsigned char SNAPSHOT_MAGIC[8] = {'M', 'B', 'C', 'S', 'N', 'A', 'P', 0};
+
 std::string TimestampStr() {
     return FormatISO8601DateTime(GetTimeMicros() / 1000000) + " ";
 }
@@ -89,26 +101,173 @@ std::vector<SnapshotEntry> LoadSnapshot(fs::path &path) {
     return vSnapshot;
 }
 
-std::vector<SnapshotEntry> EmptySnapshot() {
-    std::vector<SnapshotEntry> vSnapshot;
-    return vSnapshot;
+SnapshotFile::~SnapshotFile()
+{
+    Close();
+}
+
+void SnapshotFile::Close()
+{
+#ifndef WIN32
+    if (m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+#else
+    m_buffer.clear();
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_count = 0;
 }
 
-std::vector<SnapshotEntry> InitSnapshot(const std::string fileName, std::vector<SnapshotProvider> providers) {
+bool SnapshotFile::Open(const fs::path& path, const CMutableTransaction& coinbase, const uint256& merkle_root)
+{
+    Close();
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    m_data = static_cast<const unsigned char*>(data);
+    m_size = st.st_size;
+#else
+    fs::ifstream stream(path, std::ios::binary);
+    m_buffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    if (m_buffer.size() < HEADER_SIZE) {
+        Close();
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+
+    const unsigned char* header = m_data;
+    if (memcmp(header, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || ReadLE32(header + 8) != VERSION) {
+        Close();
+        return false;
+    }
+    const uint64_t count = ReadLE64(header + 12);
+    if (count > (m_size - HEADER_SIZE) / RECORD_SIZE || m_size != HEADER_SIZE + count * RECORD_SIZE) {
+        Close();
+        return false;
+    }
+
+    // Hash the coinbase the records complete, serialized as CTransaction does
+    // for its txid, without building it.
+    CHashWriter hasher(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS);
+    hasher << coinbase.nVersion << coinbase.vin;
+    WriteCompactSize(hasher, coinbase.vout.size() + count);
+    for (const CTxOut& txout : coinbase.vout) {
+        hasher << txout;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const std::optional<CScript> script = GetScript(i);
+        if (!script) {
+            Close();
+            return false;
+        }
+        hasher << GetAmount(i) << *script;
+    }
+    hasher << coinbase.nLockTime;
+    if (hasher.GetHash() != merkle_root) {
+        Close();
+        return false;
+    }
+
+    m_count = count;
+    return true;
+}
+
+CAmount SnapshotFile::GetAmount(size_t i) const
+{
+    return (CAmount)ReadLE64(Record(i));
+}
+
+std::optional<CScript> SnapshotFile::GetScript(size_t i) const
+{
+    const unsigned char* record = Record(i);
+    const unsigned char* hash = record + 9;
+    switch (SnapshotScriptType{record[8]}) {
+    case SnapshotScriptType::P2PKH: {
+        unsigned char script[25] = {OP_DUP, OP_HASH160, 20};
+        memcpy(script + 3, hash, 20);
+        script[23] = OP_EQUALVERIFY;
+        script[24] = OP_CHECKSIG;
+        return CScript(script, script + sizeof(script));
+    }
+    case SnapshotScriptType::P2SH: {
+        unsigned char script[23] = {OP_HASH160, 20};
+        memcpy(script + 2, hash, 20);
+        script[22] = OP_EQUAL;
+        return CScript(script, script + sizeof(script));
+    }
+    }
+    return std::nullopt;
+}
+
+bool WriteSnapshotFile(const fs::path& path, const std::vector<SnapshotEntry>& vSnapshot)
+{
+    std::vector<unsigned char> data(SnapshotFile::HEADER_SIZE + vSnapshot.size() * SnapshotFile::RECORD_SIZE);
+    unsigned char* record = data.data() + SnapshotFile::HEADER_SIZE;
+    for (const SnapshotEntry& entry : vSnapshot) {
+        WriteLE64(record, (uint64_t)entry.amount);
+        if (entry.script.IsPayToScriptHash()) {
+            record[8] = (uint8_t)SnapshotScriptType::P2SH;
+            memcpy(record + 9, entry.script.data() + 2, 20);
+        } else {
+            // ReadScriptSnapshot only produces P2PKH and P2SH scripts
+            assert(entry.script.size() == 25);
+            record[8] = (uint8_t)SnapshotScriptType::P2PKH;
+            memcpy(record + 9, entry.script.data() + 3, 20);
+        }
+        record += SnapshotFile::RECORD_SIZE;
+    }
+
+    unsigned char* header = data.data();
+    memcpy(header, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    WriteLE32(header + 8, SnapshotFile::VERSION);
+    WriteLE64(header + 12, vSnapshot.size());
+
+    fs::path path_tmp = path;
+    path_tmp += ".new";
+    FILE* file = fsbridge::fopen(path_tmp, "wb");
+    if (!file) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok &= FileCommit(file);
+    fclose(file);
+    return ok && RenameOver(path_tmp, path);
+}
+
+std::shared_ptr<const SnapshotFile> InitSnapshot(const std::string& name, std::vector<SnapshotProvider> providers, const CMutableTransaction& coinbase, const uint256& merkle_root) {
     fs::path snapshot_dir = gArgs.GetDataDirBase() / "snapshot";
-    fs::path path = snapshot_dir / fileName;
+    fs::path path = snapshot_dir / (name + ".dat");
     fs::create_directories(snapshot_dir);
 
-    if (!fs::exists(path)) {
+    auto snapshot = std::make_shared<SnapshotFile>();
+    if (snapshot->Open(path, coinbase, merkle_root)) {
+        return snapshot;
+    }
+
+    fs::path csv_path = snapshot_dir / (name + ".csv");
+    if (!fs::exists(csv_path)) {
         // Pick random snapshot provider
         std::random_device random_device;
         std::mt19937 engine {random_device()};
         std::uniform_int_distribution<int> dist(0, providers.size() - 1);
         int provider_index = dist(engine);
-        std::cout << TimestampStr() << "Shapshot: File " << fileName << " not found, trying to fetch it from " << providers[provider_index].address << providers[provider_index].path << std::endl;
-        bool loaded = FetchSnapshot(path, providers[provider_index]);
+        std::cout << TimestampStr() << "Shapshot: File " << name << ".csv not found, trying to fetch it from " << providers[provider_index].address << providers[provider_index].path << std::endl;
+        bool loaded = FetchSnapshot(csv_path, providers[provider_index]);
         assert(loaded);
     }
 
-    return LoadSnapshot(path);
+    std::cout << TimestampStr() << "Shapshot: Converting " << name << ".csv to the binary snapshot format" << std::endl;
+    bool written = WriteSnapshotFile(path, LoadSnapshot(csv_path));
+    assert(written);
+    bool opened = snapshot->Open(path, coinbase, merkle_root);
+    assert(opened);
+    return snapshot;
 }
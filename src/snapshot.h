@@ -7,6 +7,10 @@
 
 #include <primitives/transaction.h>
 #include <fs.h>
+#include <uint256.h>
+
+#include <memory>
+#include <optional>
 
 struct SnapshotEntry {
     CScript script;
@@ -18,10 +22,72 @@ struct SnapshotProvider {
     std::string path;
 };
 
+enum class SnapshotScriptType : uint8_t {
+    P2PKH = 0,
+    P2SH = 1,
+};
+
+/**
+ * Genesis snapshot in the binary format, memory-mapped read-only.
+ *
+ * The file is a fixed header followed by fixed-width records, so entries are
+ * read in place without any parsing:
+ *   header: magic (8) | version (4) | record count (8)
+ *   record: amount, little-endian (8) | script type (1) | hash160 (20)
+ *
+ * The file carries no checksum of its own. The records are the outputs the
+ * genesis coinbase pays after its first one, so they are checked against the
+ * genesis merkle root pinned in chainparams, which also ties a snapshot to the
+ * network it was converted for.
+ */
+class SnapshotFile
+{
+public:
+    static constexpr size_t HEADER_SIZE = 8 + 4 + 8;
+    static constexpr size_t RECORD_SIZE = 8 + 1 + 20;
+    static constexpr uint32_t VERSION = 2;
+
+    SnapshotFile() = default;
+    ~SnapshotFile();
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    /**
+     * Map the file and check its header and records. The records, appended to
+     * the outputs of coinbase, must give a transaction hashing to merkle_root,
+     * the root of a block made of that coinbase alone.
+     */
+    bool Open(const fs::path& path, const CMutableTransaction& coinbase, const uint256& merkle_root);
+
+    size_t size() const { return m_count; }
+
+    CAmount GetAmount(size_t i) const;
+    //! Script of record i, or nothing if its script type is unknown.
+    std::optional<CScript> GetScript(size_t i) const;
+
+private:
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+    size_t m_count{0};
+#ifdef WIN32
+    std::vector<unsigned char> m_buffer;
+#endif
+
+    const unsigned char* Record(size_t i) const { return m_data + HEADER_SIZE + i * RECORD_SIZE; }
+    void Close();
+};
+
 CScript ReadScriptSnapshot(const std::string& s);
 bool FetchSnapshot(fs::path &path, SnapshotProvider provider);
 std::vector<SnapshotEntry> LoadSnapshot(fs::path &path);
-std::vector<SnapshotEntry> EmptySnapshot();
-std::vector<SnapshotEntry> InitSnapshot(const std::string fileName, std::vector<SnapshotProvider> providers);
+bool WriteSnapshotFile(const fs::path& path, const std::vector<SnapshotEntry>& vSnapshot);
+
+/**
+ * Open the binary snapshot of a network, checked against the genesis coinbase
+ * and merkle root of that network. If it does not exist yet or does not match,
+ * the CSV snapshot is fetched from one of the providers and converted once.
+ */
+std::shared_ptr<const SnapshotFile> InitSnapshot(const std::string& name, std::vector<SnapshotProvider> providers, const CMutableTransaction& coinbase, const uint256& merkle_root);
 
 #endif // MICRO_SNAPSHOT_H
@@ -0,0 +1,147 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+#include <key.h>
+#include <pubkey.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+static uint256 AddressHash(const CKeyID& id)
+{
+    std::vector<unsigned char> bytes(32);
+    std::copy(id.begin(), id.end(), bytes.begin());
+    return uint256(bytes);
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+
+    const uint256 address = AddressHash(coinbaseKey.GetPubKey().GetID());
+    CAddressBalanceValue balance;
+
+    // Nothing is indexed before the index is started.
+    BOOST_CHECK(addressindex.FindAddressBalance(address, 1, balance));
+    BOOST_CHECK_EQUAL(balance.txCount, 0);
+
+    BOOST_REQUIRE(addressindex.Start(m_node.chainman->ActiveChainstate()));
+
+    // Allow the address index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addressindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    CAmount total = 0;
+    for (const auto& txn : m_coinbase_txns) {
+        total += txn->GetValueOut();
+    }
+
+    BOOST_CHECK(addressindex.FindAddressBalance(address, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, total);
+    BOOST_CHECK_EQUAL(balance.received, total);
+    BOOST_CHECK_EQUAL(balance.txCount, (int64_t)m_coinbase_txns.size());
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > deltas;
+    BOOST_CHECK(addressindex.FindAddressDeltas(address, 1, deltas));
+    BOOST_CHECK_EQUAL(deltas.size(), m_coinbase_txns.size());
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent;
+    BOOST_CHECK(addressindex.FindAddressUnspent(address, 1, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), m_coinbase_txns.size());
+    for (const auto& txn : m_coinbase_txns) {
+        CSpentIndexValue spent;
+        BOOST_CHECK(!addressindex.FindSpentInfo(CSpentIndexKey(txn->GetHash(), 0), spent));
+    }
+
+    // Height range queries only return the deltas of those blocks.
+    deltas.clear();
+    BOOST_CHECK(addressindex.FindAddressDeltas(address, 1, deltas, 10, 19));
+    BOOST_CHECK_EQUAL(deltas.size(), 10U);
+    // A start height alone is ignored, an end height alone is not.
+    deltas.clear();
+    BOOST_CHECK(addressindex.FindAddressDeltas(address, 1, deltas, 10, 0));
+    BOOST_CHECK_EQUAL(deltas.size(), m_coinbase_txns.size());
+    deltas.clear();
+    BOOST_CHECK(addressindex.FindAddressDeltas(address, 1, deltas, 0, 19));
+    BOOST_CHECK_EQUAL(deltas.size(), 19U);
+    std::optional<CAddressIndexKey> merge_next;
+    size_t merged_count = 0;
+    BOOST_CHECK(addressindex.MergeAddressDeltas({{address, 1}}, 10, 0, nullptr, [&](const CAddressIndexKey&, CAmount) {
+        ++merged_count;
+        return true;
+    }, merge_next));
+    BOOST_CHECK_EQUAL(merged_count, m_coinbase_txns.size());
+
+    // Paging through the history with cursors visits every delta once, in order.
+    deltas.clear();
+    BOOST_CHECK(addressindex.FindAddressDeltas(address, 1, deltas));
+    std::vector<CAddressIndexKey> paged;
+    std::optional<CAddressIndexKey> next;
+    do {
+        CAddressIndexKey from;
+        if (next) {
+            const std::string cursor = EncodeAddressCursor(*next);
+            BOOST_REQUIRE(DecodeAddressCursor(cursor, {{address, 1}}, from));
+            BOOST_CHECK(!DecodeAddressCursor(cursor, {{uint256::ONE, 1}}, from));
+        }
+        size_t page = 0;
+        BOOST_CHECK(addressindex.ScanAddressDeltas(address, 1, 0, 0, next ? &from : nullptr,
+            [&](const CAddressIndexKey& key, CAmount amount) {
+                if (page == 7) return false;
+                paged.push_back(key);
+                ++page;
+                return true;
+            }, next));
+    } while (next);
+    BOOST_REQUIRE_EQUAL(paged.size(), deltas.size());
+    for (size_t i = 0; i < paged.size(); ++i) {
+        BOOST_CHECK(paged[i].txhash == deltas[i].first.txhash);
+    }
+
+    // Deltas of several addresses are merged in height order, and paging
+    // through the merge visits each of them once.
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script = GetScriptForDestination(PKHash(other_key.GetPubKey()));
+    for (int i = 0; i < 5; i++) {
+        CreateAndProcessBlock({}, other_script);
+        CreateAndProcessBlock({}, GetScriptForDestination(PKHash(coinbaseKey.GetPubKey())));
+    }
+    BOOST_REQUIRE(addressindex.BlockUntilSyncedToCurrentChain());
+
+    const std::vector<std::pair<uint256, int> > addresses{{address, 1}, {AddressHash(other_key.GetPubKey().GetID()), 1}, {address, 1}};
+    std::vector<CAddressIndexKey> merged;
+    next.reset();
+    do {
+        CAddressIndexKey from;
+        if (next) BOOST_REQUIRE(DecodeAddressCursor(EncodeAddressCursor(*next), addresses, from));
+        size_t page = 0;
+        BOOST_CHECK(addressindex.MergeAddressDeltas(addresses, 0, 0, next ? &from : nullptr,
+            [&](const CAddressIndexKey& key, CAmount amount) {
+                if (page == 3) return false;
+                merged.push_back(key);
+                ++page;
+                return true;
+            }, next));
+    } while (next);
+    BOOST_CHECK_EQUAL(merged.size(), m_coinbase_txns.size() + 10);
+    for (size_t i = 1; i < merged.size(); ++i) {
+        BOOST_CHECK(merged[i - 1].blockHeight < merged[i].blockHeight);
+    }
+
+    // Shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,9 +7,14 @@
 #include <stdlib.h>
 
 #include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <node/blockstorage.h>
 #include <rpc/blockchain.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 #include <util/string.h>
+#include <validation.h>
 
 /* Equality between doubles is imprecise. Comparison should be done
  * with a small threshold of tolerance, rather than exact equality.
@@ -74,4 +79,68 @@ BOOST_AUTO_TEST_CASE(get_difficulty_for_very_high_target)
     TestDifficulty(0x12345678, 5913134931067755359633408.0);
 }
 
+BOOST_AUTO_TEST_CASE(disk_block_index_work_hash)
+{
+    const uint256 hash = uint256S("0x01");
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.nBits = 0x1f111111;
+    index.nStatus = BLOCK_VALID_TREE;
+
+    // Without a cached work hash the record keeps the old layout.
+    CDataStream ss_old(SER_DISK, CLIENT_VERSION);
+    ss_old << CDiskBlockIndex(&index);
+    CDiskBlockIndex old_record;
+    ss_old >> old_record;
+    BOOST_CHECK(ss_old.empty());
+    BOOST_CHECK(!(old_record.nStatus & BLOCK_HAVE_WORKHASH));
+
+    index.cacheInit = true;
+    index.cacheIndexHash = hash;
+    index.cacheWorkHash = uint256S("0x02");
+
+    CDataStream ss_new(SER_DISK, CLIENT_VERSION);
+    ss_new << CDiskBlockIndex(&index);
+    CDiskBlockIndex new_record;
+    ss_new >> new_record;
+    BOOST_CHECK(ss_new.empty());
+    BOOST_CHECK(new_record.nStatus & BLOCK_HAVE_WORKHASH);
+    BOOST_CHECK(new_record.cacheWorkHash == index.cacheWorkHash);
+    BOOST_CHECK(new_record.GetBlockWorkHash() == index.GetBlockWorkHash());
+    BOOST_CHECK(!(index.nStatus & BLOCK_HAVE_WORKHASH));
+
+    // A client predating the field may have written the status bit without
+    // the hash; its record version says to ignore the bit.
+    int legacy_version = CDiskBlockIndex::WORKHASH_VERSION - 1;
+    int height = 0;
+    uint32_t status = BLOCK_VALID_TREE | BLOCK_HAVE_WORKHASH;
+    unsigned int tx = 0;
+    CDataStream ss_legacy(SER_DISK, CLIENT_VERSION);
+    ss_legacy << VARINT_MODE(legacy_version, VarIntMode::NONNEGATIVE_SIGNED) << VARINT_MODE(height, VarIntMode::NONNEGATIVE_SIGNED)
+              << VARINT(status) << VARINT(tx) << index.nVersion << uint256() << index.hashMerkleRoot
+              << index.nTime << index.nBits << index.nNonce;
+    CDiskBlockIndex legacy_record;
+    ss_legacy >> legacy_record;
+    BOOST_CHECK(ss_legacy.empty());
+    BOOST_CHECK(!(legacy_record.nStatus & BLOCK_HAVE_WORKHASH));
+    BOOST_CHECK_EQUAL(legacy_record.nStatus, uint32_t{BLOCK_VALID_TREE});
+}
+
+BOOST_FIXTURE_TEST_CASE(raw_block_read, TestChain100Setup)
+{
+    for (int height : {100, 99, 1}) {
+        const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_node.chainman->ActiveChain()[height]);
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block;
+
+        const auto raw_block = ReadRawBlockCached(pindex, Params().MessageStart());
+        BOOST_REQUIRE(raw_block);
+        BOOST_CHECK(*raw_block == std::vector<uint8_t>(ss.begin(), ss.end()));
+        // Read again from memory.
+        BOOST_CHECK(ReadRawBlockCached(pindex, Params().MessageStart()) == raw_block);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
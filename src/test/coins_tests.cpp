@@ -273,6 +273,66 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     SimulationTest(&db_base, true);
 }
 
+// Flushes handed to the background writer stay readable until they are on disk.
+BOOST_AUTO_TEST_CASE(coins_write_behind)
+{
+    CCoinsViewDB db{"test", /*nCacheSize*/ 1 << 23, /*fMemory*/ true, /*fWipe*/ false};
+    CCoinsViewWriteBehind writer{&db, db, /*enabled*/ true};
+    CCoinsViewCache cache{&writer};
+
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 1000; ++i) {
+        outpoints.emplace_back(InsecureRand256(), InsecureRandBits(4));
+        Coin coin{CTxOut{i + 1, CScript() << OP_TRUE}, 1, false};
+        cache.AddCoin(outpoints.back(), std::move(coin), false);
+    }
+    const uint256 first_block = InsecureRand256();
+    cache.SetBestBlock(first_block);
+    writer.DeferNextWrite();
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+
+    // Whether or not the write is done, the coins and best block are there.
+    BOOST_CHECK(cache.GetBestBlock() == first_block);
+    for (int i = 0; i < 1000; ++i) {
+        const Coin& coin = cache.AccessCoin(outpoints[i]);
+        BOOST_CHECK_EQUAL(coin.out.nValue, i + 1);
+    }
+
+    // Spend half of them while the first write may still be in progress.
+    for (int i = 0; i < 1000; i += 2) {
+        BOOST_CHECK(cache.SpendCoin(outpoints[i]));
+    }
+    const uint256 second_block = InsecureRand256();
+    cache.SetBestBlock(second_block);
+    writer.DeferNextWrite();
+    BOOST_CHECK(cache.Flush());
+    for (int i = 0; i < 1000; ++i) {
+        BOOST_CHECK_EQUAL(writer.HaveCoin(outpoints[i]), i % 2 == 1);
+        BOOST_CHECK_EQUAL(cache.HaveCoin(outpoints[i]), i % 2 == 1);
+    }
+    BOOST_CHECK(writer.GetBestBlock() == second_block);
+
+    BOOST_CHECK(writer.Wait());
+    CoinsWriteBehindStats stats = writer.GetStats();
+    BOOST_CHECK(stats.enabled);
+    BOOST_CHECK_EQUAL(stats.writes, 2U);
+    BOOST_CHECK_EQUAL(stats.pending_coins, 0U);
+    BOOST_CHECK(db.GetBestBlock() == second_block);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    for (int i = 0; i < 1000; ++i) {
+        BOOST_CHECK_EQUAL(db.HaveCoin(outpoints[i]), i % 2 == 1);
+    }
+
+    // Flushes that were not announced are written synchronously.
+    cache.AddCoin(COutPoint{InsecureRand256(), 0}, Coin{CTxOut{1, CScript() << OP_TRUE}, 2, false}, false);
+    const uint256 third_block = InsecureRand256();
+    cache.SetBestBlock(third_block);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(db.GetBestBlock() == third_block);
+    BOOST_CHECK_EQUAL(writer.GetStats().writes, 2U);
+}
+
 // Store of all necessary tx and undo data for next test
 typedef std::map<COutPoint, std::tuple<CTransaction,CTxUndo,Coin>> UtxoData;
 UtxoData utxoData;
@@ -609,7 +669,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
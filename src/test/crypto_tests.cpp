@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/aes.h>
+#include <crypto/blake2b.h>
 #include <crypto/chacha20.h>
 #include <crypto/chacha_poly_aead.h>
 #include <crypto/hkdf_sha256_32.h>
@@ -14,12 +15,14 @@
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
 #include <crypto/sha512.h>
+#include <crypto/yespower/yespower.h>
 #include <crypto/muhash.h>
 #include <random.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -753,6 +756,110 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(blake2b80)
+{
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[80 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 80 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            const uint256 hash = Blake2b(in + 80 * j, in + 80 * (j + 1));
+            memcpy(out1 + 32 * j, hash.begin(), 32);
+        }
+        Blake2b80(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(yespower_implementations)
+{
+    static const yespower_params_t params = {2048, 32, (const uint8_t*)"Now I am become Death, the destroyer of worlds", 46};
+
+    // Enough inputs for a batch to be split into full and partial groups of lanes.
+    constexpr int count = 2 * YESPOWER_MAX_LANES + 1;
+    unsigned char headers[count][80];
+    yespower_binary_t expected[count];
+    BOOST_CHECK_EQUAL(YespowerAutoDetect("generic"), "generic");
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < 80; ++j) {
+            headers[i][j] = InsecureRandBits(8);
+        }
+        BOOST_REQUIRE_EQUAL(yespower_tls(headers[i], 80, &params, &expected[i]), 0);
+    }
+
+    // Every implementation this CPU supports produces the same work hashes,
+    // one at a time and in batches.
+    for (const std::string impl : {"generic", "avx512", "xop"}) {
+        if (YespowerAutoDetect(impl) != impl) continue;
+        BOOST_CHECK(yespower_lanes() >= 1 && yespower_lanes() <= YESPOWER_MAX_LANES);
+        for (int i = 0; i < count; ++i) {
+            yespower_binary_t out;
+            BOOST_REQUIRE_EQUAL(yespower_tls(headers[i], 80, &params, &out), 0);
+            BOOST_CHECK(memcmp(out.uc, expected[i].uc, sizeof(out.uc)) == 0);
+        }
+        yespower_binary_t out[count];
+        BOOST_REQUIRE_EQUAL(yespower_tls_batch(&headers[0][0], 80, &params, out, count), 0);
+        BOOST_CHECK(memcmp(out, expected, sizeof(out)) == 0);
+    }
+
+    // Unknown implementations fall back to the portable one.
+    BOOST_CHECK_EQUAL(YespowerAutoDetect("unknown"), "");
+    BOOST_CHECK(!YespowerAutoDetect().empty());
+}
+
+BOOST_AUTO_TEST_CASE(yespower_scratchpads)
+{
+    static const yespower_params_t params = {2048, 32, (const uint8_t*)"Now I am become Death, the destroyer of worlds", 46};
+    const size_t lanes = yespower_lanes();
+
+    BOOST_REQUIRE(YespowerScratchpadsSetup(2, false, 2, &params));
+    YespowerScratchpadStats stats = YespowerScratchpadsStats();
+    BOOST_CHECK_EQUAL(stats.max, 2U);
+    BOOST_CHECK_EQUAL(stats.total, 2U);
+    BOOST_CHECK_EQUAL(stats.in_use, 0U);
+    BOOST_CHECK_GE(stats.bytes, 2 * lanes * yespower_local_size(&params));
+    BOOST_CHECK_EQUAL(stats.hugetlb_bytes, 0U);
+    BOOST_CHECK_EQUAL(stats.thp_bytes, 0U);
+
+    // More threads than scratchpads hash the same as one thread, waiting for
+    // one or using a temporary scratchpad when all are in use.
+    constexpr int count = 4;
+    unsigned char headers[count][80];
+    yespower_binary_t expected[count];
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < 80; ++j) {
+            headers[i][j] = InsecureRandBits(8);
+        }
+        BOOST_REQUIRE_EQUAL(yespower_tls(headers[i], 80, &params, &expected[i]), 0);
+    }
+    yespower_binary_t out[count];
+    int ret[count];
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; ++i) {
+        threads.emplace_back([&, i] { ret[i] = yespower_tls_batch(headers[i], 80, &params, &out[i], 1); });
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (int i = 0; i < count; ++i) {
+        BOOST_CHECK_EQUAL(ret[i], 0);
+        BOOST_CHECK(memcmp(out[i].uc, expected[i].uc, sizeof(out[i].uc)) == 0);
+    }
+    // Temporary scratchpads are freed once returned.
+    stats = YespowerScratchpadsStats();
+    BOOST_CHECK_EQUAL(stats.total, 2U);
+    BOOST_CHECK_LE(stats.temporary, stats.waits);
+    BOOST_CHECK_EQUAL(stats.in_use, 0U);
+    BOOST_CHECK_GE(stats.bytes, 2 * lanes * yespower_local_size(&params));
+
+    // Setting up again frees the scratchpads not in use.
+    BOOST_REQUIRE(YespowerScratchpadsSetup(0, true));
+    stats = YespowerScratchpadsStats();
+    BOOST_CHECK_EQUAL(stats.max, 0U);
+    BOOST_CHECK_EQUAL(stats.total, 0U);
+    BOOST_CHECK_EQUAL(stats.bytes, 0U);
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -132,6 +132,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getrawmempool",
     "getrawtransaction",
     "getrpcinfo",
+    "gettotalsupply",
     "gettxout",
     "gettxoutsetinfo",
     "help",
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <policy/policy.h>
+#include <script/standard.h>
 #include <txmempool.h>
 #include <util/system.h>
 #include <util/time.h>
@@ -786,4 +787,85 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+static std::pair<uint256, int> MempoolAddress(const CTxDestination& dest)
+{
+    valtype bytes(std::visit(DataVisitor(), dest));
+    bytes.resize(32);
+    return {uint256(bytes), (int)dest.index()};
+}
+
+BOOST_AUTO_TEST_CASE(MempoolAddressIndexTest)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    const CTxDestination dest_a = PKHash(uint160(std::vector<unsigned char>(20, 0xaa)));
+    const CTxDestination dest_b = PKHash(uint160(std::vector<unsigned char>(20, 0xbb)));
+    const auto address_a = MempoolAddress(dest_a), address_b = MempoolAddress(dest_b);
+
+    CCoinsView dummy;
+    CCoinsViewCache view(&dummy);
+    const COutPoint funding(InsecureRand256(), 0);
+    view.AddCoin(funding, Coin(CTxOut(10 * COIN, GetScriptForDestination(dest_a)), 1, false), false);
+
+    // Spends from A and pays B.
+    CMutableTransaction tx1;
+    tx1.vin.emplace_back(funding);
+    tx1.vout.emplace_back(9 * COIN, GetScriptForDestination(dest_b));
+    // Pays A, entering earlier than tx1 although added after it.
+    CMutableTransaction tx2;
+    tx2.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+    tx2.vout.emplace_back(1 * COIN, GetScriptForDestination(dest_a));
+    // Pays B and A.
+    CMutableTransaction tx3;
+    tx3.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+    tx3.vout.emplace_back(2 * COIN, GetScriptForDestination(dest_b));
+    tx3.vout.emplace_back(3 * COIN, GetScriptForDestination(dest_a));
+
+    const size_t usage = pool.DynamicMemoryUsage();
+    for (const auto& [tx, time] : {std::make_pair(&tx1, 20), std::make_pair(&tx2, 10), std::make_pair(&tx3, 30)}) {
+        const CTxMemPoolEntry mempool_entry = entry.Time(time).FromTx(*tx);
+        pool.addAddressIndex(mempool_entry, view);
+        pool.addSpentIndex(mempool_entry, view);
+        pool.addUnchecked(mempool_entry);
+    }
+    BOOST_CHECK_GT(pool.DynamicMemoryUsage(), usage);
+
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> results;
+    BOOST_CHECK(pool.getAddressIndex({address_a}, results));
+    BOOST_REQUIRE_EQUAL(results.size(), 3U);
+    BOOST_CHECK(results[0].first.txhash == tx2.GetHash() && results[0].second.amount == 1 * COIN);
+    BOOST_CHECK(results[1].first.txhash == tx1.GetHash() && results[1].first.spending == 1 && results[1].second.amount == -10 * COIN);
+    BOOST_CHECK(results[1].second.prevhash == funding.hash);
+    BOOST_CHECK(results[2].first.txhash == tx3.GetHash() && results[2].first.index == 1 && results[2].second.amount == 3 * COIN);
+
+    // Several addresses come out merged in time order.
+    results.clear();
+    BOOST_CHECK(pool.getAddressIndex({address_b, address_a}, results));
+    BOOST_REQUIRE_EQUAL(results.size(), 5U);
+    for (size_t i = 1; i < results.size(); ++i) {
+        BOOST_CHECK_LE(results[i - 1].second.time, results[i].second.time);
+    }
+
+    CSpentIndexValue value;
+    BOOST_CHECK(pool.getSpentIndex(CSpentIndexKey(funding.hash, funding.n), value));
+    BOOST_CHECK(value.txid == tx1.GetHash() && value.inputIndex == 0 && value.satoshis == 10 * COIN);
+
+    // Deltas and spends go with their transactions, whatever the removal reason.
+    pool.removeRecursive(CTransaction(tx1), REMOVAL_REASON_DUMMY);
+    BOOST_CHECK(!pool.getSpentIndex(CSpentIndexKey(funding.hash, funding.n), value));
+    results.clear();
+    BOOST_CHECK(pool.getAddressIndex({address_a, address_b}, results));
+    BOOST_REQUIRE_EQUAL(results.size(), 3U);
+    BOOST_CHECK(results[0].first.txhash == tx2.GetHash());
+    BOOST_CHECK(results[1].first.txhash == tx3.GetHash() && results[2].first.txhash == tx3.GetHash());
+
+    pool.removeRecursive(CTransaction(tx2), REMOVAL_REASON_DUMMY);
+    pool.removeRecursive(CTransaction(tx3), REMOVAL_REASON_DUMMY);
+    results.clear();
+    BOOST_CHECK(pool.getAddressIndex({address_a, address_b}, results));
+    BOOST_CHECK(results.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
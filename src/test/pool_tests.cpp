@@ -0,0 +1,87 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pool_resource_reuse)
+{
+    PoolResource<128, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 1024U);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // Blocks are handed out back to back from the chunk, rounded up to 8 bytes.
+    void* a = resource.Allocate(8, 8);
+    void* b = resource.Allocate(5, 1);
+    BOOST_CHECK_EQUAL(static_cast<std::byte*>(b) - static_cast<std::byte*>(a), 8);
+
+    // Freed blocks are handed out again for the same rounded size only.
+    resource.Deallocate(a, 8, 8);
+    void* c = resource.Allocate(16, 8);
+    BOOST_CHECK(c != a);
+    void* d = resource.Allocate(7, 4);
+    BOOST_CHECK(d == a);
+
+    // Blocks above the maximum size come from operator new.
+    void* big = resource.Allocate(129, 8);
+    resource.Deallocate(big, 129, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // Running out of chunk memory takes another chunk; the rest of the
+    // first one becomes a free block.
+    std::vector<void*> blocks;
+    for (int i = 0; i < 10; ++i) {
+        blocks.push_back(resource.Allocate(128, 8));
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    for (void* block : blocks) {
+        resource.Deallocate(block, 128, 8);
+    }
+    resource.Deallocate(b, 5, 1);
+    resource.Deallocate(c, 16, 8);
+    resource.Deallocate(d, 7, 4);
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_unordered_map)
+{
+    using Map = std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                   PoolAllocator<std::pair<const uint64_t, uint64_t>, 64>>;
+    Map::allocator_type::ResourceType resource;
+    Map map{0, Map::hasher{}, Map::key_equal{}, &resource};
+    const size_t empty_usage = memusage::DynamicUsage(map);
+    const size_t empty_buckets_usage = memusage::MallocUsage(sizeof(void*) * map.bucket_count());
+
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map.emplace(i, i * i);
+    }
+    for (uint64_t i = 0; i < 1000; i += 2) {
+        map.erase(i);
+    }
+    for (uint64_t i = 0; i < 1000; ++i) {
+        BOOST_CHECK_EQUAL(map.count(i), i % 2);
+    }
+    // A thousand small nodes fit in the first chunk; only the buckets grew.
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map) - empty_usage,
+                      memusage::MallocUsage(sizeof(void*) * map.bucket_count()) - empty_buckets_usage);
+
+    // Erased nodes are reused rather than taken from new chunk memory.
+    const size_t usage = memusage::DynamicUsage(map);
+    for (uint64_t i = 0; i < 1000; i += 2) {
+        map.emplace(i, i);
+    }
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), usage);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,7 +4,9 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <consensus/merkle.h>
 #include <pow.h>
+#include <validation.h>
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
@@ -87,4 +89,133 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/** Append a block with a random timestamp and target to a chain. */
+static void AddLwma3Block(std::vector<CBlockIndex>& blocks, CBlockIndex* pprev, int64_t spacing)
+{
+    CBlockIndex& block = blocks.emplace_back();
+    block.pprev = pprev;
+    block.nHeight = pprev ? pprev->nHeight + 1 : 0;
+    // Often out of order, so that timestamps get raised.
+    block.nTime = pprev ? pprev->nTime - spacing + InsecureRandRange(spacing * 4) : 1570625829;
+    arith_uint256 target = UintToArith256(uint256S("00000fffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"));
+    target >>= InsecureRandRange(8);
+    block.nBits = target.GetCompact();
+    block.BuildSkip();
+}
+
+BOOST_AUTO_TEST_CASE(GetNextWorkRequired_test)
+{
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    // A chain, and a fork of it from height 400.
+    std::vector<CBlockIndex> chain, fork;
+    chain.reserve(1000);
+    fork.reserve(500);
+    for (int i = 0; i < 1000; ++i) {
+        AddLwma3Block(chain, i ? &chain.back() : nullptr, params.nPowTargetSpacing);
+    }
+    for (int i = 0; i < 500; ++i) {
+        AddLwma3Block(fork, i ? &fork.back() : &chain[400], params.nPowTargetSpacing);
+    }
+
+    // The cached windows give the same targets as computing them from scratch,
+    // whether extending a chain, repeating a block or jumping between chains.
+    for (int i = 0; i < 1000; ++i) {
+        BOOST_CHECK_EQUAL(GetNextWorkRequired(&chain[i], nullptr, params), Lwma3CalculateNextWorkRequired(&chain[i], params));
+        if (i < 500) {
+            BOOST_CHECK_EQUAL(GetNextWorkRequired(&fork[i], nullptr, params), Lwma3CalculateNextWorkRequired(&fork[i], params));
+        }
+    }
+    for (int i = 0; i < 100; ++i) {
+        const CBlockIndex* block = InsecureRandBool() ? &chain[InsecureRandRange(1000)] : &fork[InsecureRandRange(500)];
+        BOOST_CHECK_EQUAL(GetNextWorkRequired(block, nullptr, params), Lwma3CalculateNextWorkRequired(block, params));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SweepNonces_test)
+{
+    CBlockHeaderUncached header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = 1570625829;
+    header.nBits = 0x1f3fffff;
+
+    // The work hashes of the nonces swept below, which wrap around.
+    const uint32_t start = std::numeric_limits<uint32_t>::max() - 10, step = 7, count = 5;
+    std::vector<arith_uint256> hashes;
+    for (uint32_t i = 0; i < count; ++i) {
+        header.nNonce = start + i * step;
+        hashes.push_back(UintToArith256(header.GetWorkHash()));
+    }
+    // The nonce the header carries does not matter.
+    header.nNonce = 0;
+
+    // With each of the hashes as target, the first nonce at or below it is found.
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t expected = 0;
+        while (hashes[expected] > hashes[i]) ++expected;
+        BOOST_CHECK_EQUAL(SweepNonces(header, hashes[i], start, count, step).value_or(0), start + expected * step);
+        BOOST_CHECK(!SweepNonces(header, hashes[i], start, expected, step));
+    }
+    BOOST_CHECK(!SweepNonces(header, arith_uint256{0}, start, count, step));
+}
+
+BOOST_AUTO_TEST_CASE(CHeaderWorkCheck_test)
+{
+    Consensus::Params params;
+    params.powLimit = uint256S("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    std::vector<CBlockHeader> headers(3);
+    for (uint32_t i = 0; i < headers.size(); ++i) {
+        headers[i].nTime = 1570625829 + i * 60;
+        headers[i].nNonce = i;
+        headers[i].nBits = UintToArith256(params.powLimit).GetCompact();
+        while (!CheckProofOfWork(headers[i].GetWorkHash(), headers[i].nBits, params)) headers[i].nNonce += headers.size();
+    }
+    std::vector<const CBlockHeader*> header_ptrs{&headers[0], &headers[1], &headers[2]};
+    CHeaderWorkCheck good{header_ptrs, params};
+    BOOST_CHECK(good());
+
+    // A header missing its target fails the check, with the hashes still cached.
+    // The copies carry the caches of the originals, which a changed field makes stale.
+    std::vector<CBlockHeader> copies(headers);
+    copies[1].nBits = 0x03000001;
+    CHeaderWorkCheck bad{{&copies[0], &copies[1], &copies[2]}, params};
+    BOOST_CHECK(!bad());
+    BOOST_CHECK(copies[2].GetWorkHashCached() == headers[2].GetWorkHash());
+    BOOST_CHECK(copies[1].GetWorkHashCached() == copies[1].GetWorkHash());
+    BOOST_CHECK(copies[1].GetWorkHashCached() != headers[1].GetWorkHashCached());
+
+    // Changing a header after its work hash was cached refreshes the cache.
+    CBlockHeader header = headers[0];
+    BOOST_CHECK(header.GetWorkHashCached() == headers[0].GetWorkHash());
+    ++header.nNonce;
+    BOOST_CHECK(header.GetWorkHashCached() == header.GetWorkHash());
+    BOOST_CHECK(header.GetWorkHashCached() != headers[0].GetWorkHash());
+    --header.nNonce;
+    CBlockHeader::CacheWorkHashes(std::vector<const CBlockHeader*>{&header});
+    BOOST_CHECK(header.cacheWorkHash == headers[0].GetWorkHash());
+}
+
+BOOST_AUTO_TEST_CASE(GenesisBlock_lazy_test)
+{
+    // Mainnet is left out, its genesis block needs the snapshot file.
+    for (const std::string& chain : {CBaseChainParams::TESTNET, CBaseChainParams::SIGNET, CBaseChainParams::REGTEST}) {
+        const auto chainParams = CreateChainParams(*m_node.args, chain);
+        const Consensus::Params& params = chainParams->GetConsensus();
+        const CBlock& genesis = chainParams->GenesisBlock();
+        BOOST_CHECK_EQUAL(genesis.GetIndexHash(), params.hashGenesisBlock);
+        BOOST_CHECK_EQUAL(genesis.GetIndexHash(), chainParams->GenesisBlockHeader().GetIndexHash());
+        BOOST_CHECK_EQUAL(genesis.hashMerkleRoot, chainParams->GenesisBlockHeader().hashMerkleRoot);
+        BOOST_CHECK_EQUAL(genesis.hashMerkleRoot, BlockMerkleRoot(genesis));
+        if (!params.hashGenesisBlockWork.IsNull()) {
+            BOOST_CHECK_EQUAL(genesis.GetWorkHash(), params.hashGenesisBlockWork);
+        }
+        BOOST_CHECK(CheckProofOfWork(genesis.GetWorkHash(), genesis.nBits, params));
+        // Built once, later calls return the same block.
+        BOOST_CHECK(&chainParams->GenesisBlock() == &genesis);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+// Copyright (c) 2021 MicroBitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <fs.h>
+#include <snapshot.h>
+#include <test/util/setup_common.h>
+#include <util/strencodings.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(snapshot_tests, BasicTestingSetup)
+
+namespace {
+
+CMutableTransaction TestCoinbase()
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << OP_0;
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    return coinbase;
+}
+
+std::vector<SnapshotEntry> TestEntries()
+{
+    return {
+        {ReadScriptSnapshot("OP_DUP OP_HASH160 1d6b2f4b6a7ee8f7de2c9d6e0e1b3f2b1ad5c3e9 OP_EQUALVERIFY OP_CHECKSIG"), 12 * COIN},
+        {ReadScriptSnapshot("OP_HASH160 6a2a0c0c4b6c0b1d0e4f2e7a3b1c5d9e8f7a6b5c OP_EQUAL"), 3456},
+        {ReadScriptSnapshot("OP_DUP OP_HASH160 00112233445566778899aabbccddeeff00112233 OP_EQUALVERIFY OP_CHECKSIG"), 1},
+    };
+}
+
+/** Merkle root of a block holding only the coinbase with the entries appended. */
+uint256 TestMerkleRoot(const std::vector<SnapshotEntry>& entries)
+{
+    CMutableTransaction tx = TestCoinbase();
+    for (const SnapshotEntry& entry : entries) {
+        tx.vout.emplace_back(entry.amount, entry.script);
+    }
+    return tx.GetHash();
+}
+
+/** Overwrite one byte of a file. */
+void PatchFile(const fs::path& path, long offset, unsigned char value)
+{
+    FILE* file = fsbridge::fopen(path, "r+b");
+    BOOST_REQUIRE(file);
+    BOOST_REQUIRE_EQUAL(fseek(file, offset, SEEK_SET), 0);
+    BOOST_REQUIRE_EQUAL(fwrite(&value, 1, 1, file), 1U);
+    fclose(file);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(snapshot_file_roundtrip)
+{
+    const fs::path path = m_args.GetDataDirBase() / "snapshot_roundtrip.dat";
+    const std::vector<SnapshotEntry> entries = TestEntries();
+    BOOST_REQUIRE(WriteSnapshotFile(path, entries));
+    BOOST_CHECK_EQUAL(fs::file_size(path), SnapshotFile::HEADER_SIZE + entries.size() * SnapshotFile::RECORD_SIZE);
+
+    SnapshotFile snapshot;
+    BOOST_REQUIRE(snapshot.Open(path, TestCoinbase(), TestMerkleRoot(entries)));
+    BOOST_REQUIRE_EQUAL(snapshot.size(), entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        BOOST_CHECK_EQUAL(snapshot.GetAmount(i), entries[i].amount);
+        const std::optional<CScript> script = snapshot.GetScript(i);
+        BOOST_REQUIRE(script);
+        BOOST_CHECK(*script == entries[i].script);
+    }
+    BOOST_CHECK(snapshot.GetScript(1)->IsPayToScriptHash());
+
+    // A root pinned for other content, or another coinbase, does not match.
+    BOOST_CHECK(!snapshot.Open(path, TestCoinbase(), TestMerkleRoot({entries[0], entries[1]})));
+    CMutableTransaction other_coinbase = TestCoinbase();
+    other_coinbase.vout[0].nValue += 1;
+    BOOST_CHECK(!snapshot.Open(path, other_coinbase, TestMerkleRoot(entries)));
+    BOOST_CHECK_EQUAL(snapshot.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_file_bad_checksum)
+{
+    const fs::path path = m_args.GetDataDirBase() / "snapshot_bad_checksum.dat";
+    const std::vector<SnapshotEntry> entries = TestEntries();
+    const uint256 merkle_root = TestMerkleRoot(entries);
+    BOOST_REQUIRE(WriteSnapshotFile(path, entries));
+
+    // Flip a bit of the second amount.
+    PatchFile(path, SnapshotFile::HEADER_SIZE + SnapshotFile::RECORD_SIZE, (3456 & 0xff) ^ 1);
+    SnapshotFile snapshot;
+    BOOST_CHECK(!snapshot.Open(path, TestCoinbase(), merkle_root));
+
+    // Truncated or unknown versions are rejected before hashing.
+    BOOST_REQUIRE(WriteSnapshotFile(path, entries));
+    BOOST_CHECK(snapshot.Open(path, TestCoinbase(), merkle_root));
+    PatchFile(path, 8, SnapshotFile::VERSION + 1);
+    BOOST_CHECK(!snapshot.Open(path, TestCoinbase(), merkle_root));
+    fs::resize_file(path, SnapshotFile::HEADER_SIZE - 1);
+    BOOST_CHECK(!snapshot.Open(path, TestCoinbase(), merkle_root));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_file_unknown_type)
+{
+    const fs::path path = m_args.GetDataDirBase() / "snapshot_unknown_type.dat";
+    const std::vector<SnapshotEntry> entries = TestEntries();
+    BOOST_REQUIRE(WriteSnapshotFile(path, entries));
+
+    // Script type of the last record, which is P2PKH.
+    const long type_offset = SnapshotFile::HEADER_SIZE + 2 * SnapshotFile::RECORD_SIZE + 8;
+    PatchFile(path, type_offset, 2);
+    SnapshotFile snapshot;
+    BOOST_CHECK(!snapshot.Open(path, TestCoinbase(), TestMerkleRoot(entries)));
+
+    // Even a root computed as if the record were P2SH does not get it accepted.
+    std::vector<SnapshotEntry> as_p2sh = entries;
+    as_p2sh[2].script = ReadScriptSnapshot("OP_HASH160 00112233445566778899aabbccddeeff00112233 OP_EQUAL");
+    BOOST_CHECK(!snapshot.Open(path, TestCoinbase(), TestMerkleRoot(as_p2sh)));
+    PatchFile(path, type_offset, uint8_t(SnapshotScriptType::P2SH));
+    BOOST_CHECK(snapshot.Open(path, TestCoinbase(), TestMerkleRoot(as_p2sh)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,7 +10,9 @@
 #include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/blake2b.h>
 #include <crypto/sha256.h>
+#include <crypto/yespower/yespower.h>
 #include <init.h>
 #include <interfaces/chain.h>
 #include <miner.h>
@@ -108,6 +110,8 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName, const std::ve
     AppInitParameterInteraction(*m_node.args);
     LogInstance().StartLogging();
     SHA256AutoDetect();
+    Blake2bAutoDetect();
+    YespowerAutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
@@ -151,6 +155,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     // Start script-checking threads. Set g_parallel_script_checks to true so they are used.
     constexpr int script_check_threads = 2;
     StartScriptCheckWorkerThreads(script_check_threads);
+    StartHeaderWorkerThreads(script_check_threads);
     g_parallel_script_checks = true;
 }
 
@@ -158,6 +163,7 @@ ChainTestingSetup::~ChainTestingSetup()
 {
     if (m_node.scheduler) m_node.scheduler->stop();
     StopScriptCheckWorkerThreads();
+    StopHeaderWorkerThreads();
     GetMainSignals().FlushBackgroundCallbacks();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     m_node.connman.reset();
@@ -10,10 +10,63 @@
 
 #include <test/util/setup_common.h>
 
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(validation_tests, TestingSetup)
 
+BOOST_AUTO_TEST_CASE(block_subsidy_test)
+{
+    // Regtest, whose subsidy hardfork at height 200 pays 11000000000 coins
+    // and lowers the reduction rate from 30% to 18% per epoch.
+    const Consensus::Params& consensus = Params().GetConsensus();
+    BOOST_REQUIRE_EQUAL(consensus.nSubsidyHeight, 200);
+    BOOST_REQUIRE_EQUAL(consensus.rewardEpoch, 1051920);
+
+    BOOST_CHECK_EQUAL(GetBlockSubsidy(10000000, consensus), 83375864092);
+    // The subsidy runs out after about 140M blocks.
+    BOOST_CHECK_EQUAL(GetBlockSubsidy(143293574, consensus), 1);
+    BOOST_CHECK_EQUAL(GetBlockSubsidy(143293575, consensus), 0);
+    BOOST_CHECK_EQUAL(GetBlockSubsidy(std::numeric_limits<int>::max(), consensus), 0);
+
+    const std::vector<std::pair<int, CAmount>> subsidies{
+        {0, 550000000000},
+        {1, 549999813511},
+        {199, 549962889989},
+        {200, 1100000000000000000},
+        {201, 549979144481},
+        {65535, 543241901287},
+        {65536, 543241798801},
+        {1051919, 451000076629},
+        {1051920, 450999991545},
+        {1051921, 450999906461},
+        {2103840, 369819986134},
+    };
+    for (const auto& [height, subsidy] : subsidies) {
+        BOOST_CHECK_MESSAGE(GetBlockSubsidy(height, consensus) == subsidy, "subsidy at height " << height);
+    }
+    // Each epoch cuts the reward by 18%, give or take rounding.
+    BOOST_CHECK_LE(std::abs(GetBlockSubsidy(1051920, consensus) - 4510 * COIN), COIN / 100);
+    BOOST_CHECK_LE(std::abs(GetBlockSubsidy(2103840, consensus) - 3698.2 * COIN), COIN / 100);
+
+    const std::vector<std::pair<int, CAmount>> supplies{
+        {0, 550000000000},
+        {199, 109996288957338},
+        {200, 1100109996288957338},
+        {201, 1100110546268101819},
+        {100000, 1154484436582048400},
+        {1051920, 1624764808772646233},
+        {2103840, 2055071945232580858},
+    };
+    for (const auto& [height, supply] : supplies) {
+        BOOST_CHECK_MESSAGE(GetBlockSupply(height, consensus) == supply, "supply at height " << height);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(signet_parse_tests)
 {
     ArgsManager signet_argsman;
@@ -9,8 +9,11 @@
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
+#include <sync.h>
 #include <uint256.h>
 #include <util/system.h>
+#include <util/thread.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <util/vector.h>
 #include <validation.h>
@@ -18,6 +21,11 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
 static constexpr uint8_t DB_COIN{'C'};
 static constexpr uint8_t DB_COINS{'c'};
 static constexpr uint8_t DB_BLOCK_FILES{'f'};
@@ -29,12 +37,6 @@ static constexpr uint8_t DB_FLAG{'F'};
 static constexpr uint8_t DB_REINDEX_FLAG{'R'};
 static constexpr uint8_t DB_LAST_BLOCK{'l'};
 
-static constexpr uint8_t DB_ADDRESSINDEX{'a'};
-static constexpr uint8_t DB_ADDRESSUNSPENTINDEX{'u'};
-static constexpr uint8_t DB_TIMESTAMPINDEX{'S'};
-static constexpr uint8_t DB_BLOCKHASHINDEX{'z'};
-static constexpr uint8_t DB_SPENTINDEX{'p'};
-
 namespace {
 
 struct CoinEntry {
@@ -89,6 +91,14 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // The map's pool keeps erased nodes, so there is nothing to gain from
+    // erasing them while writing.
+    bool ret = WriteCoins(mapCoins, hashBlock);
+    mapCoins.clear();
+    return ret;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(*m_db);
     size_t count = 0;
     size_t changed = 0;
@@ -113,7 +123,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -123,8 +133,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
@@ -154,6 +162,176 @@ size_t CCoinsViewDB::EstimateSize() const
     return m_db->EstimateSize(DB_COIN, uint8_t(DB_COIN + 1));
 }
 
+/** The changed coins of a deferred flush, with the pool they are allocated from. */
+struct CCoinsViewWriteBehind::Snapshot {
+    CCoinsMapMemoryResource resource{};
+    CCoinsMap coins{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+    uint256 best_block;
+};
+
+CCoinsViewWriteBehind::CCoinsViewWriteBehind(CCoinsView* view, CCoinsViewDB& db, bool enabled)
+    : CCoinsViewBacked(view), m_db(db), m_enabled(enabled) {}
+
+CCoinsViewWriteBehind::~CCoinsViewWriteBehind()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+std::shared_ptr<const CCoinsViewWriteBehind::Snapshot> CCoinsViewWriteBehind::Pending() const
+{
+    if (!m_enabled) return nullptr;
+    LOCK(m_mutex);
+    return m_pending;
+}
+
+bool CCoinsViewWriteBehind::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    if (const auto pending = Pending()) {
+        const auto it = pending->coins.find(outpoint);
+        if (it != pending->coins.end()) {
+            if (it->second.coin.IsSpent()) return false;
+            coin = it->second.coin;
+            return true;
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewWriteBehind::HaveCoin(const COutPoint &outpoint) const
+{
+    if (const auto pending = Pending()) {
+        const auto it = pending->coins.find(outpoint);
+        if (it != pending->coins.end()) return !it->second.coin.IsSpent();
+    }
+    return base->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewWriteBehind::GetBestBlock() const
+{
+    if (const auto pending = Pending()) return pending->best_block;
+    return base->GetBestBlock();
+}
+
+std::vector<uint256> CCoinsViewWriteBehind::GetHeadBlocks() const
+{
+    Wait();
+    return base->GetHeadBlocks();
+}
+
+std::unique_ptr<CCoinsViewCursor> CCoinsViewWriteBehind::Cursor() const
+{
+    Wait();
+    return base->Cursor();
+}
+
+void CCoinsViewWriteBehind::DeferNextWrite()
+{
+    if (m_enabled) m_defer_next = true;
+}
+
+void CCoinsViewWriteBehind::WaitLocked(DebugLock<Mutex>& lock) const
+{
+    if (!m_writing) return;
+    const auto start = std::chrono::steady_clock::now();
+    while (m_writing) m_cond.wait(lock);
+    m_stats.wait_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+bool CCoinsViewWriteBehind::Wait() const
+{
+    if (!m_enabled) return true;
+    WAIT_LOCK(m_mutex, lock);
+    WaitLocked(lock);
+    return !m_failed;
+}
+
+bool CCoinsViewWriteBehind::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    if (!m_defer_next.exchange(false)) {
+        if (!Wait()) return false;
+        return base->BatchWrite(mapCoins, hashBlock);
+    }
+
+    // Only the changed coins need writing; the rest are in the database
+    // already. The write in flight, if any, does not touch mapCoins, so the
+    // copy can be made before waiting for it.
+    assert(!hashBlock.IsNull());
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->best_block = hashBlock;
+    for (auto& [outpoint, entry] : mapCoins) {
+        if (entry.flags & CCoinsCacheEntry::DIRTY) {
+            CCoinsCacheEntry& copy = snapshot->coins.emplace(outpoint, CCoinsCacheEntry{std::move(entry.coin)}).first->second;
+            copy.flags = CCoinsCacheEntry::DIRTY;
+        }
+    }
+    mapCoins.clear();
+
+    {
+        WAIT_LOCK(m_mutex, lock);
+        WaitLocked(lock);
+        if (m_failed) return false;
+        m_pending = std::move(snapshot);
+        m_writing = true;
+        if (!m_thread.joinable()) {
+            m_thread = std::thread(&util::TraceThread, "coinsflush", [this] { ThreadWrite(); });
+        }
+    }
+    m_cond.notify_all();
+    return true;
+}
+
+void CCoinsViewWriteBehind::ThreadWrite()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (true) {
+        while (!m_writing && !m_stop) m_cond.wait(lock);
+        // A write handed over before shutdown is finished first.
+        if (!m_writing) return;
+
+        const std::shared_ptr<const Snapshot> snapshot = m_pending;
+        const auto start = std::chrono::steady_clock::now();
+        bool ok = false;
+        {
+            REVERSE_LOCK(lock);
+            try {
+                ok = m_db.WriteCoins(snapshot->coins, snapshot->best_block);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+            }
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        LogPrint(BCLog::COINDB, "Wrote %u coins to the coin database in the background in %.2fs\n",
+                 snapshot->coins.size(), CountSecondsDouble(elapsed));
+
+        ++m_stats.writes;
+        m_stats.write_time += elapsed;
+        m_stats.last_write_time = elapsed;
+        if (ok) {
+            m_pending.reset();
+        } else {
+            // Keep the snapshot readable; the node shuts down on the next flush.
+            LogPrintf("Failed to write coins to the coin database in the background\n");
+            m_failed = true;
+        }
+        m_writing = false;
+        m_cond.notify_all();
+    }
+}
+
+CoinsWriteBehindStats CCoinsViewWriteBehind::GetStats() const
+{
+    LOCK(m_mutex);
+    CoinsWriteBehindStats stats = m_stats;
+    stats.enabled = m_enabled;
+    stats.pending_coins = m_pending ? m_pending->coins.size() : 0;
+    return stats;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.GetDataDirNet() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -255,6 +433,9 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
+// Records are stamped with CLIENT_VERSION, which tells readers whether they may carry the work hash.
+static_assert(CLIENT_VERSION >= CDiskBlockIndex::WORKHASH_VERSION, "block index records would not carry the work hash");
+
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
@@ -279,43 +460,193 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+namespace {
+
+//! Number of key ranges the block index is split into for loading.
+constexpr int BLOCK_INDEX_LOAD_RANGES = 256;
+//! Maximum number of threads decoding the block index at startup.
+constexpr int MAX_BLOCK_INDEX_LOAD_THREADS = 16;
+
+/** The decoded block index records of one key range, with their block hashes. */
+struct BlockIndexRange
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::vector<CDiskBlockIndex> entries;
+    std::vector<uint256> hashes;
+    bool ok{true};
+};
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+/**
+ * Decode the block index records whose block hash starts with a byte in
+ * [begin, end), and compute their block hashes.
+ */
+void ReadBlockIndexRange(CDBWrapper& db, int begin, int end, BlockIndexRange& range)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    uint256 start;
+    *start.begin() = begin;
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, start));
 
-    // Load m_block_index
     while (pcursor->Valid()) {
-        if (ShutdownRequested()) return false;
+        if (ShutdownRequested()) {
+            range.ok = false;
+            return;
+        }
         std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= end) {
+            break;
+        }
+        range.entries.emplace_back();
+        if (!pcursor->GetValue(range.entries.back())) {
+            range.ok = error("%s: failed to read value", __func__);
+            return;
+        }
+        pcursor->Next();
+    }
+
+    // Hash the headers a batch at a time, so that Blake2b80() can compute
+    // several of them together.
+    static constexpr size_t BATCH_SIZE = 256;
+    std::vector<CBlockHeaderUncached> headers;
+    std::vector<const CBlockHeaderUncached*> header_ptrs;
+    range.hashes.resize(range.entries.size());
+    for (size_t i = 0; i < range.entries.size(); i += BATCH_SIZE) {
+        const size_t count = std::min(BATCH_SIZE, range.entries.size() - i);
+        headers.clear();
+        header_ptrs.clear();
+        for (size_t j = 0; j < count; ++j) {
+            headers.push_back(range.entries[i + j].GetUncachedHeader());
+        }
+        for (const CBlockHeaderUncached& header : headers) {
+            header_ptrs.push_back(&header);
+        }
+        GetIndexHashes(header_ptrs, Span<uint256>(range.hashes).subspan(i, count));
+    }
+}
+
+} // namespace
+
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<void(size_t)> reserveBlockIndex, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int threads)
+{
+    const int64_t start_time = GetTimeMicros();
+    if (threads <= 0) {
+        threads = std::clamp(GetNumCores(), 1, MAX_BLOCK_INDEX_LOAD_THREADS);
+    }
+
+    // Records are decoded and hashed by key range on up to threads threads,
+    // this one included. The ranges are linked into the block index here, in
+    // key order, as they become ready, and freed as soon as they are linked.
+    // Decoding stays at most lookahead ranges ahead of the linking, so only
+    // that many decoded ranges are ever held at once.
+    const int lookahead = 2 * threads;
+    std::vector<BlockIndexRange> ranges(BLOCK_INDEX_LOAD_RANGES);
+    std::vector<bool> ready(BLOCK_INDEX_LOAD_RANGES);
+    Mutex ready_mutex;
+    std::condition_variable ready_cv;
+    int next_range = 0; // guarded by ready_mutex
+    int linked = 0;     // guarded by ready_mutex
+    bool stop = false;  // guarded by ready_mutex
+
+    // Decode the next range, first waiting for the linking to catch up if
+    // wait is set. Returns false once there is nothing left to decode, or
+    // without wait if decoding is too far ahead.
+    const auto decode_next = [&](bool wait) {
+        int r;
+        {
+            WAIT_LOCK(ready_mutex, lock);
+            if (wait) {
+                ready_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(ready_mutex) {
+                    return stop || next_range >= BLOCK_INDEX_LOAD_RANGES || next_range < linked + lookahead;
+                });
             }
-        } else {
+            if (stop || next_range >= BLOCK_INDEX_LOAD_RANGES || next_range >= linked + lookahead) return false;
+            r = next_range++;
+        }
+        ReadBlockIndexRange(*this, r * 256 / BLOCK_INDEX_LOAD_RANGES, (r + 1) * 256 / BLOCK_INDEX_LOAD_RANGES, ranges[r]);
+        {
+            LOCK(ready_mutex);
+            ready[r] = true;
+        }
+        ready_cv.notify_all();
+        return true;
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(&util::TraceThread, "loadblkidx", [&] { while (decode_next(true)) {} });
+    }
+
+    bool ok = true;
+    size_t loaded = 0;
+    for (int r = 0; r < BLOCK_INDEX_LOAD_RANGES && ok; ++r) {
+        // Help decoding until range r is ready.
+        while (true) {
+            {
+                LOCK(ready_mutex);
+                if (ready[r]) break;
+            }
+            if (!decode_next(false)) {
+                WAIT_LOCK(ready_mutex, lock);
+                ready_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(ready_mutex) { return ready[r]; });
+                break;
+            }
+        }
+
+        BlockIndexRange& range = ranges[r];
+        if (!range.ok) {
+            ok = false;
             break;
         }
+        if (r == 0) {
+            // Block hashes are uniformly distributed over the key space, so the
+            // first range tells how many entries to make room for.
+            reserveBlockIndex(range.entries.size() * BLOCK_INDEX_LOAD_RANGES * 9 / 8);
+        }
+
+        for (size_t i = 0; i < range.entries.size(); ++i) {
+            const CDiskBlockIndex& diskindex = range.entries[i];
+            // Construct block index object
+            const uint256& hash = range.hashes[i];
+            CBlockIndex* pindexNew = insertBlockIndex(hash);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus & ~BLOCK_HAVE_WORKHASH;
+            pindexNew->nTx            = diskindex.nTx;
+            if (diskindex.nStatus & BLOCK_HAVE_WORKHASH) {
+                pindexNew->cacheIndexHash = hash;
+                pindexNew->cacheWorkHash  = diskindex.cacheWorkHash;
+                pindexNew->cacheInit      = true;
+            }
+        }
+        loaded += range.entries.size();
+        range = BlockIndexRange{};
+        {
+            LOCK(ready_mutex);
+            linked = r + 1;
+        }
+        ready_cv.notify_all();
+    }
+
+    {
+        LOCK(ready_mutex);
+        stop = true;
     }
+    ready_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (!ok) return false;
 
+    const int64_t elapsed = GetTimeMicros() - start_time;
+    LogPrintf("%s: loaded %u block index entries in %dms (%.0f entries/s, %d threads)\n", __func__,
+        loaded, elapsed / 1000, elapsed > 0 ? loaded * 1e6 / elapsed : 0.0, threads);
     return true;
 }
 
@@ -440,161 +771,3 @@ bool CCoinsViewDB::Upgrade() {
     LogPrintf("[%s].\n", ShutdownRequested() ? "CANCELLED" : "DONE");
     return !ShutdownRequested();
 }
-
-
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressIndex(uint256 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    if (start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
-    } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
-    }
-
-    while (pcursor->Valid()) {
-        std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
-            if (end > 0 && key.second.blockHeight > end) {
-                break;
-            }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address index value");
-            }
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint256 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
-
-    while (pcursor->Valid()) {
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager &chainman) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
-
-    while (pcursor->Valid()) {
-        std::pair<char, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
-            if (fActiveOnly) {
-                if (blockOnchainActive(key.second.blockHash, chainman)) {
-                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-                }
-            } else {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-            }
-
-            pcursor->Next();
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
-
-    CTimestampBlockIndexValue lts;
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
-       return false;
-
-    ltimestamp = lts.ltimestamp;
-    return true;
-}
-
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
-}
-
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::blockOnchainActive(const uint256 &hash, ChainstateManager &chainman) {
-    LOCK(cs_main);
-    BlockMap::iterator mi = chainman.BlockIndex().find(hash);
-    if (mi == chainman.BlockIndex().end())
-        return false;
-
-    CBlockIndex* pblockindex = (*mi).second;
-    return pblockindex && chainman.ActiveChain().Contains(pblockindex);
-}
@@ -18,7 +18,9 @@
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <optional>
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
@@ -427,6 +429,9 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     RemoveUnbroadcastTx(hash, true /* add logging because unchecked */ );
 
+    removeAddressIndex(hash);
+    removeSpentIndex(it->GetTx());
+
     if (vTxHashes.size() > 1) {
         vTxHashes[it->vTxHashesIdx] = std::move(vTxHashes.back());
         vTxHashes[it->vTxHashesIdx].second->vTxHashesIdx = it->vTxHashesIdx;
@@ -589,10 +594,6 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
         }
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
-        if (fAddressIndex) {
-            removeAddressIndex(tx->GetHash());
-            removeSpentIndex(tx->GetHash());
-        }
     }
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = true;
@@ -605,6 +606,10 @@ void CTxMemPool::_clear()
     totalTxSize = 0;
     m_total_fee = 0;
     cachedInnerUsage = 0;
+    mapAddress.clear();
+    mapAddressInserted.clear();
+    cachedAddressIndexUsage = 0;
+    mapSpent.clear();
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
@@ -959,7 +964,8 @@ void CCoinsViewMemPool::PackageAddTransaction(const CTransactionRef& tx)
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage +
+           memusage::DynamicUsage(mapAddress) + memusage::DynamicUsage(mapAddressInserted) + cachedAddressIndexUsage + memusage::DynamicUsage(mapSpent);
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -1148,29 +1154,48 @@ void CTxMemPool::SetIsLoaded(bool loaded)
     m_is_loaded = loaded;
 }
 
+SaltedAddressHasher::SaltedAddressHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+static bool CompareAddressDeltaTime(const CMempoolAddressDeltaEntry& a, const CMempoolAddressDeltaEntry& b)
+{
+    return a.delta.time < b.delta.time;
+}
+
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    const int64_t time = entry.GetTime().count();
+    std::vector<CMempoolAddressKey> inserted;
 
     uint256 txhash = tx.GetHash();
+    auto insert = [&](const CTxDestination& dest, const CMempoolAddressDeltaEntry& delta) EXCLUSIVE_LOCKS_REQUIRED(cs) {
+        valtype bytesID(std::visit(DataVisitor(), dest));
+        if (bytesID.empty()) {
+            return;
+        }
+        valtype addressBytes(32);
+        std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+        const CMempoolAddressKey key(dest.index(), uint256(addressBytes));
+
+        std::vector<CMempoolAddressDeltaEntry>& run = mapAddress[key];
+        cachedAddressIndexUsage -= memusage::DynamicUsage(run);
+        // Entries normally arrive in time order, so this is an append; only
+        // mempool loading and mock time can put one further in.
+        run.insert(std::upper_bound(run.begin(), run.end(), delta, CompareAddressDeltaTime), delta);
+        cachedAddressIndexUsage += memusage::DynamicUsage(run);
+        if (std::find(inserted.begin(), inserted.end(), key) == inserted.end()) {
+            inserted.push_back(key);
+        }
+    };
+
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
         const CTxIn input = tx.vin[j];
         const CTxOut &prevout = view.GetOutputFor(input);
 
         CTxDestination dest;
         if (ExtractDestination(input.prevout, prevout.scriptPubKey, dest)) {
-            valtype bytesID(std::visit(DataVisitor(), dest));
-            if(bytesID.empty()) {
-                continue;
-            }
-            valtype addressBytes(32);
-            std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-            CMempoolAddressDeltaKey key(dest.index(), uint256(addressBytes), txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime().count(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            insert(dest, CMempoolAddressDeltaEntry(txhash, j, 1, CMempoolAddressDelta(time, prevout.nValue * -1, input.prevout.hash, input.prevout.n)));
         }
     }
 
@@ -1179,48 +1204,64 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 
         CTxDestination dest;
         if (ExtractDestination({tx.GetHash(), k}, out.scriptPubKey, dest)) {
-            valtype bytesID(std::visit(DataVisitor(), dest));
-            if(bytesID.empty()) {
-                continue;
-            }
-            valtype addressBytes(32);
-            std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-            CMempoolAddressDeltaKey key(dest.index(), uint256(addressBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime().count(), out.nValue)));
-            inserted.push_back(key);
+            insert(dest, CMempoolAddressDeltaEntry(txhash, k, 0, CMempoolAddressDelta(time, out.nValue)));
         }
     }
 
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+    inserted.shrink_to_fit();
+    cachedAddressIndexUsage += memusage::DynamicUsage(inserted);
+    mapAddressInserted.emplace(txhash, std::make_pair(time, std::move(inserted)));
 }
 
-bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint256, int> > &addresses, std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
+bool CTxMemPool::getAddressIndex(const std::vector<std::pair<uint256, int> > &addresses, std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results) const
 {
     LOCK(cs);
-    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
+    for (const auto& [addressHash, addressType] : addresses) {
+        addressDeltaMap::const_iterator ait = mapAddress.find(CMempoolAddressKey(addressType, addressHash));
+        if (ait == mapAddress.end()) {
+            continue;
         }
+        // Each run is in time order already; merge it with the previous ones.
+        const size_t middle = results.size();
+        results.reserve(middle + ait->second.size());
+        for (const CMempoolAddressDeltaEntry& entry : ait->second) {
+            results.emplace_back(CMempoolAddressDeltaKey(addressType, addressHash, entry.txhash, entry.index, entry.spending), entry.delta);
+        }
+        std::inplace_merge(results.begin(), results.begin() + middle, results.end(), [](const auto& a, const auto& b) {
+            return a.second.time < b.second.time;
+        });
     }
     return true;
 }
 
-bool CTxMemPool::removeAddressIndex(const uint256 txhash)
+void CTxMemPool::removeAddressIndex(const uint256& txhash)
 {
-    LOCK(cs);
+    AssertLockHeld(cs);
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
+    if (it == mapAddressInserted.end()) {
+        return;
+    }
 
-    if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+    const auto& [time, keys] = it->second;
+    for (const CMempoolAddressKey& key : keys) {
+        addressDeltaMap::iterator ait = mapAddress.find(key);
+        assert(ait != mapAddress.end());
+        std::vector<CMempoolAddressDeltaEntry>& run = ait->second;
+        cachedAddressIndexUsage -= memusage::DynamicUsage(run);
+        // The transaction's deltas are among those of its entry time.
+        const auto [begin, end] = std::equal_range(run.begin(), run.end(), CMempoolAddressDeltaEntry(txhash, 0, 0, CMempoolAddressDelta(time, 0)), CompareAddressDeltaTime);
+        run.erase(std::remove_if(begin, end, [&](const CMempoolAddressDeltaEntry& entry) { return entry.txhash == txhash; }), end);
+        if (run.empty()) {
+            mapAddress.erase(ait);
+            continue;
+        }
+        if (run.size() * 2 < run.capacity()) {
+            run.shrink_to_fit();
         }
-        mapAddressInserted.erase(it);
+        cachedAddressIndexUsage += memusage::DynamicUsage(run);
     }
-
-    return true;
+    cachedAddressIndexUsage -= memusage::DynamicUsage(keys);
+    mapAddressInserted.erase(it);
 }
 
 void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
@@ -1228,7 +1269,6 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
     LOCK(cs);
 
     const CTransaction& tx = entry.GetTx();
-    std::vector<CSpentIndexKey> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -1265,22 +1305,14 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
             addressType = 0;
         }
 
-        CSpentIndexKey key = CSpentIndexKey(input.prevout.hash, input.prevout.n);
-        CSpentIndexValue value = CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash);
-
-        mapSpent.insert(std::make_pair(key, value));
-        inserted.push_back(key);
+        mapSpent.insert_or_assign(input.prevout, CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash));
     }
-
-    mapSpentInserted.insert(std::make_pair(txhash, inserted));
 }
 
-bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const
+bool CTxMemPool::getSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) const
 {
     LOCK(cs);
-    mapSpentIndex::const_iterator it;
-
-    it = mapSpent.find(key);
+    mapSpentIndex::const_iterator it = mapSpent.find(COutPoint(key.txid, key.outputIndex));
     if (it != mapSpent.end()) {
         value = it->second;
         return true;
@@ -1288,18 +1320,16 @@ bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) con
     return false;
 }
 
-bool CTxMemPool::removeSpentIndex(const uint256 txhash)
+void CTxMemPool::removeSpentIndex(const CTransaction& tx)
 {
-    LOCK(cs);
-    mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
-
-    if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapSpent.erase(*mit);
+    AssertLockHeld(cs);
+    if (mapSpent.empty()) {
+        return;
+    }
+    for (const CTxIn& txin : tx.vin) {
+        mapSpentIndex::iterator it = mapSpent.find(txin.prevout);
+        if (it != mapSpent.end() && it->second.txid == tx.GetHash()) {
+            mapSpent.erase(it);
         }
-        mapSpentInserted.erase(it);
     }
-
-    return true;
 }
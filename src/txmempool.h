@@ -11,6 +11,7 @@
 #include <optional>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -66,17 +67,6 @@ struct CompareIteratorByHash {
     }
 };
 
-struct CSpentIndexKeyCompare
-{
-    bool operator()(const CSpentIndexKey& a, const CSpentIndexKey& b) const {
-        if (a.txid == b.txid) {
-            return a.outputIndex < b.outputIndex;
-        } else {
-            return a.txid < b.txid;
-        }
-    }
-};
-
 struct CMempoolAddressDelta
 {
     int64_t time;
@@ -124,29 +114,46 @@ struct CMempoolAddressDeltaKey
     }
 };
 
-struct CMempoolAddressDeltaKeyCompare
+/** The address a mempool address delta belongs to: its type and hash. */
+struct CMempoolAddressKey
 {
-    bool operator()(const CMempoolAddressDeltaKey& a, const CMempoolAddressDeltaKey& b) const {
-        if (a.type == b.type) {
-            if (a.addressBytes == b.addressBytes) {
-                if (a.txhash == b.txhash) {
-                    if (a.index == b.index) {
-                        return a.spending < b.spending;
-                    } else {
-                        return a.index < b.index;
-                    }
-                } else {
-                    return a.txhash < b.txhash;
-                }
-            } else {
-                return a.addressBytes < b.addressBytes;
-            }
-        } else {
-            return a.type < b.type;
-        }
+    int type;
+    uint256 hash;
+
+    CMempoolAddressKey(int addressType, const uint256& addressHash) : type(addressType), hash(addressHash) {}
+
+    friend bool operator==(const CMempoolAddressKey& a, const CMempoolAddressKey& b)
+    {
+        return a.type == b.type && a.hash == b.hash;
     }
 };
 
+class SaltedAddressHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedAddressHasher();
+
+    size_t operator()(const CMempoolAddressKey& key) const noexcept {
+        return SipHashUint256Extra(k0, k1, key.hash, key.type);
+    }
+};
+
+/** A mempool address delta as kept in the run of its address. */
+struct CMempoolAddressDeltaEntry
+{
+    uint256 txhash;
+    unsigned int index;
+    int spending;
+    CMempoolAddressDelta delta;
+
+    CMempoolAddressDeltaEntry(const uint256& hash, unsigned int i, int s, const CMempoolAddressDelta& d)
+        : txhash(hash), index(i), spending(s), delta(d) {}
+};
+
 /** \class CTxMemPoolEntry
  *
  * CTxMemPoolEntry stores data about the corresponding transaction, as well
@@ -655,17 +662,26 @@ public:
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
+    /**
+     * Address deltas of the mempool transactions by address, each run in
+     * entry time order, so an address query is a copy of its run. For
+     * removal, the time and the addresses each transaction was added under.
+     * The vectors' memory is tracked in cachedAddressIndexUsage.
+     */
+    typedef std::unordered_map<CMempoolAddressKey, std::vector<CMempoolAddressDeltaEntry>, SaltedAddressHasher> addressDeltaMap;
+    addressDeltaMap mapAddress GUARDED_BY(cs);
+
+    typedef std::unordered_map<uint256, std::pair<int64_t, std::vector<CMempoolAddressKey>>, SaltedTxidHasher> addressDeltaMapInserted;
+    addressDeltaMapInserted mapAddressInserted GUARDED_BY(cs);
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
-    addressDeltaMapInserted mapAddressInserted;
+    size_t cachedAddressIndexUsage GUARDED_BY(cs){0};
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
-    mapSpentIndex mapSpent;
+    /** Spending inputs of the mempool transactions by the outpoint they spend. */
+    typedef std::unordered_map<COutPoint, CSpentIndexValue, SaltedOutpointHasher> mapSpentIndex;
+    mapSpentIndex mapSpent GUARDED_BY(cs);
 
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
-    mapSpentIndexInserted mapSpentInserted;
+    void removeAddressIndex(const uint256& txhash) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void removeSpentIndex(const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     void UpdateParent(txiter entry, txiter parent, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
     void UpdateChild(txiter entry, txiter child, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -709,14 +725,14 @@ public:
     void addUnchecked(const CTxMemPoolEntry& entry, bool validFeeEstimate = true) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
     void addUnchecked(const CTxMemPoolEntry& entry, setEntries& setAncestors, bool validFeeEstimate = true) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
 
+    /** Index the address deltas of entry, which must be added right after. They are dropped with it. */
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
-    bool getAddressIndex(std::vector<std::pair<uint256, int> > &addresses,
-                         std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
-    bool removeAddressIndex(const uint256 txhash);
+    /** The address deltas of addresses, in entry time order. */
+    bool getAddressIndex(const std::vector<std::pair<uint256, int> > &addresses,
+                         std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results) const;
 
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
-    bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const;
-    bool removeSpentIndex(const uint256 txhash);
+    bool getSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) const;
 
     void removeRecursive(const CTransaction& tx, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
     void removeForReorg(CChainState& active_chainstate, int flags) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
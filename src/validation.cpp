@@ -14,6 +14,7 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/yespower/yespower.h>
 #include <cuckoocache.h>
 #include <deploymentstatus.h>
 #include <flatfile.h>
@@ -55,9 +56,17 @@
 #include <key_io.h>
 #include <script/standard.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <forward_list>
+#include <limits>
 #include <numeric>
 #include <optional>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -118,6 +127,7 @@ bool CBlockIndexWorkComparator::operator()(const CBlockIndex *pa, const CBlockIn
 RecursiveMutex cs_main;
 
 CBlockIndex *pindexBestHeader = nullptr;
+uint64_t g_block_index_unloads = 0;
 Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
@@ -126,6 +136,7 @@ bool fAddressIndex = false;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fCoinsWriteBehind = DEFAULT_COINS_WRITE_BEHIND;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
 uint256 hashAssumeValid;
@@ -1194,20 +1205,161 @@ CTransactionRef GetTransaction(const CBlockIndex* const block_index, const CTxMe
     return nullptr;
 }
 
-CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
+namespace {
+/**
+ * Parameters of a subsidy schedule: base reward, epoch length, reduction
+ * rates before and after the subsidy hardfork, hardfork height and amount.
+ * The hardfork fields are read from the global chain params, as the subsidy
+ * formula always did.
+ */
+using SubsidySchedule = std::tuple<CAmount, int, double, double, int, CAmount>;
+
+SubsidySchedule GetSubsidySchedule(const Consensus::Params& consensusParams)
 {
-    double rewardEpochRate = consensusParams.rewardEpochRate;
+    const Consensus::Params& global = ::Params().GetConsensus();
+    return {consensusParams.baseReward, consensusParams.rewardEpoch, consensusParams.rewardEpochRate,
+            consensusParams.rewardEpochRate_v2, global.nSubsidyHeight, global.nSubsidyAmount};
+}
+
+CAmount ComputeBlockSubsidy(int nHeight, const SubsidySchedule& schedule)
+{
+    const auto& [baseReward, rewardEpoch, rewardEpochRate_v1, rewardEpochRate_v2, nSubsidyHeight, nSubsidyAmount] = schedule;
+    double rewardEpochRate = rewardEpochRate_v1;
 
     // Subsidy hardfork
-    if (nHeight == ::Params().GetConsensus().nSubsidyHeight)
-        return ::Params().GetConsensus().nSubsidyAmount;
+    if (nHeight == nSubsidyHeight)
+        return nSubsidyAmount;
 
     // Updated epoch reduction rate post hardfork
-    if (nHeight > ::Params().GetConsensus().nSubsidyHeight)
-        rewardEpochRate = consensusParams.rewardEpochRate_v2;
+    if (nHeight > nSubsidyHeight)
+        rewardEpochRate = rewardEpochRate_v2;
 
-    const long double r = 1 + (std::log(1 - rewardEpochRate) / consensusParams.rewardEpoch);
-    return consensusParams.baseReward * std::pow(r, nHeight);
+    const long double r = 1 + (std::log(1 - rewardEpochRate) / rewardEpoch);
+    return baseReward * std::pow(r, nHeight);
+}
+
+/**
+ * First height from which a subsidy schedule pays nothing: the reward decays
+ * geometrically after the hardfork, so the height is found by bisection.
+ */
+int FindZeroSubsidyHeight(const SubsidySchedule& schedule)
+{
+    int high = std::numeric_limits<int>::max();
+    if (ComputeBlockSubsidy(high, schedule) > 0) return high;
+    int low = std::max(std::get<4>(schedule) + 1, 0);
+    while (low < high) {
+        const int mid = low + (high - low) / 2;
+        if (ComputeBlockSubsidy(mid, schedule) > 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * Issued supply of a subsidy schedule, kept as one entry per era of ERA_SIZE
+ * heights: the prefix sum of the block subsidies, each computed with the
+ * formula above, before the first height of the era. The supply at a height
+ * adds the subsidies since the start of its era to the entry.
+ *
+ * The subsidy reaches zero after about 140M heights, which caps the table at
+ * well under a megabyte. Entries are filled in height order, up to the highest
+ * era asked for. An entry is immutable once published, so lookups only take
+ * the mutex the first time they reach an era that is not filled yet.
+ */
+class SubsidyTable
+{
+public:
+    static constexpr int ERA_SIZE{1 << 14};
+
+    const SubsidySchedule m_schedule;
+    //! Heights from this one on have no subsidy
+    const int m_zero_height;
+    //! Next table in g_subsidy_tables, set before this one is published
+    const SubsidyTable* const m_next;
+
+    SubsidyTable(const SubsidySchedule& schedule, const SubsidyTable* next)
+        : m_schedule{schedule}, m_zero_height{FindZeroSubsidyHeight(schedule)}, m_next{next},
+          m_era_supply((m_zero_height - 1) / ERA_SIZE + 1) {}
+
+    CAmount GetSubsidy(int nHeight) const
+    {
+        if (nHeight >= m_zero_height) return 0;
+        return ComputeBlockSubsidy(nHeight, m_schedule);
+    }
+
+    CAmount GetSupply(int nHeight) const
+    {
+        assert(nHeight >= 0);
+        nHeight = std::min(nHeight, m_zero_height - 1);
+        const int era = nHeight / ERA_SIZE;
+        CAmount supply = GetEraSupply(era);
+        for (int height = era * ERA_SIZE; height <= nHeight; ++height) {
+            supply += ComputeBlockSubsidy(height, m_schedule);
+        }
+        return supply;
+    }
+
+private:
+    mutable Mutex m_mutex;
+    //! Number of entries filled, the first one is always zero
+    mutable std::atomic<size_t> m_built{1};
+    mutable std::vector<CAmount> m_era_supply;
+
+    CAmount GetEraSupply(size_t era) const
+    {
+        if (era < m_built.load(std::memory_order_acquire)) return m_era_supply[era];
+
+        LOCK(m_mutex);
+        for (size_t built = m_built.load(std::memory_order_relaxed); built <= era; ++built) {
+            CAmount supply = m_era_supply[built - 1];
+            for (int height = (built - 1) * ERA_SIZE; height < (int)built * ERA_SIZE; ++height) {
+                supply += ComputeBlockSubsidy(height, m_schedule);
+            }
+            m_era_supply[built] = supply;
+            m_built.store(built + 1, std::memory_order_release);
+        }
+        return m_era_supply[era];
+    }
+};
+
+/**
+ * Tables of the subsidy schedules seen so far. There is one per chain in
+ * practice, so they are kept in a list that is only ever prepended to, and
+ * read without a lock.
+ */
+Mutex g_subsidy_mutex;
+std::forward_list<SubsidyTable> g_subsidy_tables GUARDED_BY(g_subsidy_mutex);
+std::atomic<const SubsidyTable*> g_subsidy_tables_head{nullptr};
+
+const SubsidyTable& GetSubsidyTable(const Consensus::Params& consensusParams)
+{
+    const SubsidySchedule schedule = GetSubsidySchedule(consensusParams);
+    for (const SubsidyTable* table = g_subsidy_tables_head.load(std::memory_order_acquire); table; table = table->m_next) {
+        if (table->m_schedule == schedule) return *table;
+    }
+
+    LOCK(g_subsidy_mutex);
+    const SubsidyTable* head = g_subsidy_tables_head.load(std::memory_order_relaxed);
+    for (const SubsidyTable* table = head; table; table = table->m_next) {
+        if (table->m_schedule == schedule) return *table;
+    }
+    const SubsidyTable& table = g_subsidy_tables.emplace_front(schedule, head);
+    g_subsidy_tables_head.store(&table, std::memory_order_release);
+    return table;
+}
+} // namespace
+
+CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
+{
+    return GetSubsidyTable(consensusParams).GetSubsidy(nHeight);
+}
+
+CAmount GetBlockSupply(int nHeight, const Consensus::Params& consensusParams)
+{
+    return GetSubsidyTable(consensusParams).GetSupply(nHeight);
 }
 
 CoinsViews::CoinsViews(
@@ -1216,11 +1368,12 @@ CoinsViews::CoinsViews(
     bool in_memory,
     bool should_wipe) : m_dbview(
                             gArgs.GetDataDirNet() / ldb_name, cache_size_bytes, in_memory, should_wipe),
-                        m_catcherview(&m_dbview) {}
+                        m_catcherview(&m_dbview),
+                        m_writebehindview(&m_catcherview, m_dbview, fCoinsWriteBehind) {}
 
 void CoinsViews::InitCache()
 {
-    m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview = std::make_unique<CCoinsViewCache>(&m_writebehindview);
 }
 
 CChainState::CChainState(CTxMemPool* mempool, BlockManager& blockman, std::optional<uint256> from_snapshot_blockhash)
@@ -1570,9 +1723,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
@@ -1592,26 +1742,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
             }
         }
 
-        if (pfClean == NULL && fAddressIndex) {
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                CTxDestination dest;
-                if (ExtractDestination({hash, k}, out.scriptPubKey, dest)) {
-                    valtype bytesID(std::visit(DataVisitor(), dest));
-                    if(bytesID.empty()) {
-                        continue;
-                    }
-                    valtype addressBytes(32);
-                    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), hash, k), CAddressUnspentValue()));
-                }
-            }
-        }
-
         // restore inputs
         if (i > 0) { // not coinbases
             CTxUndo &txundo = blockUndo.vtxundo[i-1];
@@ -1632,17 +1762,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (pfClean == NULL && fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            error("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            error("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -1658,6 +1777,38 @@ void StopScriptCheckWorkerThreads()
     scriptcheckqueue.StopWorkerThreads();
 }
 
+bool CHeaderWorkCheck::operator()()
+{
+    CBlockHeader::CacheWorkHashes(m_headers);
+    for (const CBlockHeader* header : m_headers) {
+        if (!CheckProofOfWork(header->GetWorkHashCached(), header->nBits, *m_params)) return false;
+    }
+    return true;
+}
+
+std::vector<CHeaderWorkCheck> MakeHeaderWorkChecks(const std::vector<const CBlockHeader*>& headers, const Consensus::Params& params)
+{
+    const size_t lanes = yespower_lanes();
+    std::vector<CHeaderWorkCheck> vChecks;
+    vChecks.reserve((headers.size() + lanes - 1) / lanes);
+    for (size_t i = 0; i < headers.size(); i += lanes) {
+        vChecks.emplace_back(std::vector<const CBlockHeader*>(headers.begin() + i, headers.begin() + std::min(i + lanes, headers.size())), params);
+    }
+    return vChecks;
+}
+
+static CCheckQueue<CHeaderWorkCheck> headerworkqueue(8);
+
+void StartHeaderWorkerThreads(int threads_num)
+{
+    headerworkqueue.StartWorkerThreads(threads_num, "headerpow");
+}
+
+void StopHeaderWorkerThreads()
+{
+    headerworkqueue.StopWorkerThreads();
+}
+
 /**
  * Threshold condition checker that triggers when unknown versionbits are seen on the network.
  */
@@ -1849,10 +2000,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     int64_t nSigOpsCost = 0;
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
@@ -1887,29 +2034,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 LogPrintf("ERROR: %s: contains a non-BIP68-final transaction\n", __func__);
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
-
-                    CTxDestination dest;
-                    if (ExtractDestination(input.prevout, prevout.scriptPubKey, dest)) {
-                        valtype bytesID(std::visit(DataVisitor(), dest));
-                        if(bytesID.empty()) {
-                            continue;
-                        }
-                        valtype addressBytes(32);
-                        std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, tx.GetHash(), j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, prevout.nValue, dest.index(), uint256(addressBytes))));
-                    }
-                }
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -1937,26 +2061,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             control.Add(vChecks);
         }
 
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                CTxDestination dest;
-                if (ExtractDestination({tx.GetHash(), k}, out.scriptPubKey, dest)) {
-                    valtype bytesID(std::visit(DataVisitor(), dest));
-                    if(bytesID.empty()) {
-                        continue;
-                    }
-                    valtype addressBytes(32);
-                    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, tx.GetHash(), k, false), out.nValue));
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), tx.GetHash(), k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                }
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -1995,36 +2099,6 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
     assert(pindex->phashBlock);
 
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-        }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
-    }
-
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2084,6 +2158,11 @@ bool CChainState::FlushStateToDisk(
 
     try {
     {
+        // A failed background write left the coin database behind the chain.
+        if (CoinsWriteBehind().Failed()) {
+            return AbortNode(state, "Failed to write to coin database");
+        }
+
         bool fFlushForPrune = false;
         bool fDoFullFlush = false;
 
@@ -2170,6 +2249,11 @@ bool CChainState::FlushStateToDisk(
             if (fFlushForPrune) {
                 LOG_TIME_MILLIS_WITH_CATEGORY("unlink pruned files", BCLog::BENCH);
 
+                // The coin database must not be left further behind the
+                // chain than the blocks needed to replay it.
+                if (!CoinsWriteBehind().Wait()) {
+                    return AbortNode(state, "Failed to write to coin database");
+                }
                 UnlinkPrunedFiles(setFilesToPrune);
             }
             nLastWrite = nNow;
@@ -2188,6 +2272,11 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Disk space is too low!"));
             }
             // Flush the chainstate (which may refer to block index entries).
+            // Flushes that only make room in the cache may finish in the
+            // background; shutdown and pruning need the database up to date.
+            if (mode != FlushStateMode::ALWAYS && !fFlushForPrune) {
+                CoinsWriteBehind().DeferNextWrite();
+            }
             if (!CoinsTip().Flush())
                 return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
@@ -2420,6 +2509,15 @@ bool CChainState::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew
                 InvalidBlockFound(pindexNew, state);
             return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), state.ToString());
         }
+        if (!pindexNew->cacheInit && blockConnecting.cacheInit) {
+            // Entry was loaded from a block index record without a stored
+            // work hash; keep the one computed while checking the block.
+            LOCK(blockConnecting.cacheLock);
+            pindexNew->cacheIndexHash = blockConnecting.cacheIndexHash;
+            pindexNew->cacheWorkHash = blockConnecting.cacheWorkHash;
+            pindexNew->cacheInit = true;
+            setDirtyBlockIndex.insert(pindexNew);
+        }
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         assert(nBlocksTotal > 0);
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
@@ -2966,7 +3064,10 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = m_block_index_arena.Allocate();
+    *pindexNew = CBlockIndex(block);
+    // A work hash cached before a header field changed is not this block's.
+    if (pindexNew->cacheIndexHash != hash) pindexNew->cacheInit = false;
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3440,6 +3541,67 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationS
 bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, BlockValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
     AssertLockNotHeld(cs_main);
+    {
+        // Compute the work hashes of the headers we don't know yet on the
+        // worker threads, without holding cs_main. AcceptBlockHeader then
+        // only has to compare the cached results against the targets. The
+        // caller passes a connected sequence (net_processing checks that),
+        // so each header's target can be checked against its predecessor
+        // before anything is hashed: only the leading headers that extend a
+        // known header, claim the required target and pass the checkpoints
+        // are hashed. The rest is left to AcceptBlockHeader, which stops at
+        // the first header that fails.
+        std::vector<const CBlockHeaderUncached*> header_ptrs;
+        for (const CBlockHeader& header : headers) {
+            header_ptrs.push_back(&header);
+        }
+        std::vector<uint256> hashes(headers.size());
+        GetIndexHashes(header_ptrs, hashes);
+        // Stand-ins for the index entries of the unknown headers, for the
+        // targets of their successors.
+        std::deque<CBlockIndex> pending;
+        std::vector<const CBlockHeader*> unknown;
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindexPrev = headers.empty() ? nullptr : m_blockman.LookupBlockIndex(headers[0].hashPrevBlock);
+            const CBlockIndex* pcheckpoint = fCheckpointsEnabled ? m_blockman.GetLastCheckpoint(chainparams.Checkpoints()) : nullptr;
+            for (size_t i = 0; i < headers.size() && pindexPrev; ++i) {
+                if (const CBlockIndex* pindex = m_blockman.LookupBlockIndex(hashes[i])) {
+                    pindexPrev = pindex;
+                    continue;
+                }
+                const int nHeight = pindexPrev->nHeight + 1;
+                // GetNextWorkRequired, without moving its shared windows onto
+                // the stand-ins.
+                if (headers[i].nBits != Lwma3CalculateNextWorkRequired(pindexPrev, chainparams.GetConsensus())) break;
+                if (pcheckpoint && nHeight < pcheckpoint->nHeight) break;
+                if (fCheckpointsEnabled && !m_blockman.CheckHardened(nHeight, hashes[i], chainparams.Checkpoints())) break;
+                CBlockIndex& entry = pending.emplace_back(headers[i]);
+                entry.phashBlock = &hashes[i];
+                entry.pprev = const_cast<CBlockIndex*>(pindexPrev);
+                entry.nHeight = nHeight;
+                entry.BuildSkip();
+                pindexPrev = &entry;
+                unknown.push_back(&headers[i]);
+            }
+        }
+        // Hash in chunks that double in size while the headers pass, so that
+        // headers with bad proof of work cost at most as much hashing as the
+        // good ones before them, plus one yespower batch.
+        size_t done = 0;
+        size_t chunk = yespower_lanes();
+        while (unknown.size() > 1 && done < unknown.size()) {
+            const size_t end = std::min(unknown.size(), done + chunk);
+            std::vector<CHeaderWorkCheck> vChecks = MakeHeaderWorkChecks({unknown.begin() + done, unknown.begin() + end}, chainparams.GetConsensus());
+            CCheckQueueControl<CHeaderWorkCheck> control(&headerworkqueue);
+            control.Add(vChecks);
+            // A failed check only means AcceptBlockHeader will find a
+            // header with bad proof of work below, and reject it there.
+            if (!control.Wait()) break;
+            done = end;
+            chunk *= 2;
+        }
+    }
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
@@ -3778,7 +3940,7 @@ CBlockIndex * BlockManager::InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = m_block_index_arena.Allocate();
     mi = m_block_index.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -3790,7 +3952,11 @@ bool BlockManager::LoadBlockIndex(
     CBlockTreeDB& blocktree,
     std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
+    const auto reserve = [this](size_t count) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        m_block_index.reserve(m_block_index.size() + count);
+        m_block_index_arena.Reserve(count);
+    };
+    if (!blocktree.LoadBlockIndexGuts(consensus_params, reserve, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
         return false;
 
     // Calculate nChainWork
@@ -3841,14 +4007,12 @@ bool BlockManager::LoadBlockIndex(
 }
 
 void BlockManager::Unload() {
+    ++g_block_index_unloads;
     m_failed_blocks.clear();
     m_blocks_unlinked.clear();
 
-    for (const BlockMap::value_type& entry : m_block_index) {
-        delete entry.second;
-    }
-
     m_block_index.clear();
+    m_block_index_arena.Clear();
 }
 
 bool CChainState::LoadBlockIndexDB()
@@ -3903,9 +4067,6 @@ bool CChainState::LoadBlockIndexDB()
     pblocktree->ReadReindexing(fReindexing);
     if(fReindexing) fReindex = true;
 
-    pblocktree->ReadFlag("addrindex", fAddressIndex);
-    LogPrintf("LoadBlockIndexDB(): address index %s\n", fAddressIndex ? "enabled" : "disabled");
-
     return true;
 }
 
@@ -4223,9 +4384,6 @@ bool ChainstateManager::LoadBlockIndex()
         // needs_init.
 
         LogPrintf("Initializing databases...\n");
-
-        fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRINDEX);
-        pblocktree->WriteFlag("addrindex", fAddressIndex);
     }
     return true;
 }
@@ -4238,7 +4396,7 @@ bool CChainState::LoadGenesisBlock()
     // m_blockman.m_block_index. Note that we can't use m_chain here, since it is
     // set based on the coins db, not the block index db, which is the only
     // thing loaded at this point.
-    if (m_blockman.m_block_index.count(m_params.GenesisBlock().GetIndexHash()))
+    if (m_blockman.m_block_index.count(m_params.GetConsensus().hashGenesisBlock))
         return true;
 
     try {
@@ -4575,6 +4733,8 @@ bool CChainState::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
     size_t old_coinstip_size = m_coinstip_cache_size_bytes;
     m_coinstip_cache_size_bytes = coinstip_size;
     m_coinsdb_cache_size_bytes = coinsdb_size;
+    // The database is reopened, which must not happen under a background write.
+    CoinsWriteBehind().Wait();
     CoinsDB().ResizeCache(coinsdb_size);
 
     LogPrintf("[%s] resized coinsdb cache to %.1f MiB\n",
@@ -5164,50 +5324,3 @@ void ChainstateManager::MaybeRebalanceCaches()
         }
     }
 }
-
-bool GetAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
-{
-    if (!fAddressIndex)
-        return error("address index not enabled");
-
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
-        return error("unable to get txids for address");
-
-    return true;
-}
-
-bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CTxMemPool& mempool)
-{
-    if (!fAddressIndex)
-        return false;
-
-    if (mempool.getSpentIndex(key, value))
-        return true;
-
-    if (!pblocktree->ReadSpentIndex(key, value))
-        return false;
-
-    return true;
-}
-
-bool GetAddressUnspent(uint256 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
-{
-    if (!fAddressIndex)
-        return error("address index not enabled");
-
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
-        return error("unable to get txids for address");
-
-    return true;
-}
-
-bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager& chainman)
-{
-    if (!fAddressIndex)
-        return error("Timestamp index not enabled");
-
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes, chainman))
-        return error("Unable to get hashes for timestamps");
-
-    return true;
-}
@@ -75,11 +75,17 @@ static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -powscratchpads default (0 = one per core) */
+static const int DEFAULT_POW_SCRATCHPADS = 0;
+/** -powhugepages default */
+static const bool DEFAULT_POW_HUGEPAGES = true;
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
 static const bool DEFAULT_ADDRINDEX = false;
 static constexpr bool DEFAULT_COINSTATSINDEX{false};
+/** Default for -coinswritebehind */
+static constexpr bool DEFAULT_COINS_WRITE_BEHIND{false};
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
@@ -121,6 +127,8 @@ extern bool fAddressIndex;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Whether to write coins cache flushes on a background thread. */
+extern bool fCoinsWriteBehind;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -135,6 +143,9 @@ extern arith_uint256 nMinimumChainWork;
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex *pindexBestHeader;
 
+/** Number of times a block index was unloaded, so that caches keeping CBlockIndex pointers can tell theirs are stale. */
+extern uint64_t g_block_index_unloads GUARDED_BY(cs_main);
+
 /** Documentation for argument 'checklevel'. */
 extern const std::vector<std::string> CHECKLEVEL_DOC;
 
@@ -144,6 +155,10 @@ void UnloadBlockIndex(CTxMemPool* mempool, ChainstateManager& chainman);
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
+/** Run instances of header work hash worker threads */
+void StartHeaderWorkerThreads(int threads_num);
+/** Stop all of the header work hash worker threads */
+void StopHeaderWorkerThreads();
 /**
  * Return transaction from the block at block_index.
  * If block_index is not provided, fall back to mempool.
@@ -158,6 +173,8 @@ void StopScriptCheckWorkerThreads();
  */
 CTransactionRef GetTransaction(const CBlockIndex* const block_index, const CTxMemPool* const mempool, const uint256& hash, const Consensus::Params& consensusParams, uint256& hashBlock);
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
+/** Total amount issued by the block subsidies of heights 0 to nHeight. */
+CAmount GetBlockSupply(int nHeight, const Consensus::Params& consensusParams);
 
 bool AbortNode(BlockValidationState& state, const std::string& strMessage, const bilingual_str& userMessage = bilingual_str{});
 
@@ -331,19 +348,38 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
-/** Initializes the script-execution cache */
-void InitScriptExecutionCache();
+/**
+ * Closure representing the yespower computation of a few headers, so that the
+ * work hashes of a HEADERS batch can be computed in parallel before the
+ * headers are accepted one by one under cs_main. Each closure hashes its
+ * headers in one interleaved batch, so it should hold yespower_lanes() of
+ * them. The results are kept in the headers' work hash caches, and the
+ * closure fails if any of its headers misses its target, so that the queue
+ * stops hashing the rest of the batch.
+ */
+class CHeaderWorkCheck
+{
+private:
+    std::vector<const CBlockHeader*> m_headers;
+    const Consensus::Params* m_params{nullptr};
 
-bool GetAddressIndex(uint256 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+public:
+    CHeaderWorkCheck() {}
+    CHeaderWorkCheck(std::vector<const CBlockHeader*> headers, const Consensus::Params& params) : m_headers(std::move(headers)), m_params(&params) {}
 
-bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CTxMemPool& mempool);
+    bool operator()();
 
-bool GetAddressUnspent(uint256 addressHash, int type,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+    void swap(CHeaderWorkCheck& check) {
+        m_headers.swap(check.m_headers);
+        std::swap(m_params, check.m_params);
+    }
+};
 
-bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager& chainman);
+/** Group the headers into work checks of yespower_lanes() headers each. */
+std::vector<CHeaderWorkCheck> MakeHeaderWorkChecks(const std::vector<const CBlockHeader*>& headers, const Consensus::Params& params);
+
+/** Initializes the script-execution cache */
+void InitScriptExecutionCache();
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -432,6 +468,9 @@ private:
      */
     void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight, int chain_tip_height, int prune_height, bool is_ibd);
 
+    //! Owns every entry of m_block_index.
+    CBlockIndexArena m_block_index_arena GUARDED_BY(cs_main);
+
 public:
     BlockMap m_block_index GUARDED_BY(cs_main);
 
@@ -537,11 +576,16 @@ public:
     //! This view wraps access to the leveldb instance and handles read errors gracefully.
     CCoinsViewErrorCatcher m_catcherview GUARDED_BY(cs_main);
 
+    //! This view writes flushes of the cache to m_dbview, in the background if
+    //! -coinswritebehind is set. It is not guarded by cs_main, as its writer
+    //! thread and the stats are synchronized internally.
+    CCoinsViewWriteBehind m_writebehindview;
+
     //! This is the top layer of the cache hierarchy - it keeps as many coins in memory as
     //! can fit per the dbcache setting.
     std::unique_ptr<CCoinsViewCache> m_cacheview GUARDED_BY(cs_main);
 
-    //! This constructor initializes CCoinsViewDB and CCoinsViewErrorCatcher instances, but it
+    //! This constructor initializes CCoinsViewDB, CCoinsViewErrorCatcher and CCoinsViewWriteBehind instances, but it
     //! *does not* create a CCoinsViewCache instance by default. This is done separately because the
     //! presence of the cache has implications on whether or not we're allowed to flush the cache's
     //! state to disk, which should not be done until the health of the database is verified.
@@ -684,6 +728,13 @@ public:
         return m_coins_views->m_catcherview;
     }
 
+    //! @returns A reference to the view that writes coins cache flushes to the
+    //!     coin database, possibly in the background.
+    CCoinsViewWriteBehind& CoinsWriteBehind() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        return m_coins_views->m_writebehindview;
+    }
+
     //! Destructs all objects related to accessing the UTXO set.
     void ResetCoinsViews() { m_coins_views.reset(); }
 
@@ -69,6 +69,7 @@ class BlockchainTest(MicroBitcoinTestFramework):
         self._test_waitforblockheight()
         self._test_getblock()
         assert self.nodes[0].verifychain(4, 0)
+        self._test_getblockhashes()
 
     def mine_chain(self):
         self.log.info('Create some old blocks')
@@ -332,6 +333,64 @@ class BlockchainTest(MicroBitcoinTestFramework):
         # This should be 2 hashes every 10 minutes or 1/300
         assert abs(hashes_per_second * 300 - 1) < 0.0001
 
+        # A series of windows gives the estimate of each, from the chain work
+        # and the time span of its blocks.
+        node = self.nodes[0]
+        headers = [node.getblockheader(node.getblockhash(height)) for height in range(node.getblockcount() + 1)]
+        windows = [{}, {"nblocks": -1}, {"nblocks": 1, "height": 1}, {"nblocks": 100, "height": 150}, {"nblocks": 1000}, {"nblocks": 70, "height": 130}, {"height": 0}]
+        series = node.getnetworkhashpsseries(windows)
+        assert_equal(len(series), len(windows))
+        for window, estimate in zip(windows, series):
+            assert_equal(estimate["hashps"], node.getnetworkhashps(window.get("nblocks", 120), window.get("height", -1)))
+            if estimate["height"] == 0:
+                assert_equal(estimate["hashps"], 0)
+                continue
+            span = headers[estimate["height"] - estimate["nblocks"]:estimate["height"] + 1]
+            work = int(span[-1]["chainwork"], 16) - int(span[0]["chainwork"], 16)
+            time_span = max(h["time"] for h in span) - min(h["time"] for h in span)
+            assert abs(estimate["hashps"] * time_span / work - 1) < 1e-9
+        assert_equal([(e["nblocks"], e["height"]) for e in series], [(120, 200), (90, 200), (1, 1), (100, 150), (200, 200), (70, 130), (0, 0)])
+        assert_raises_rpc_error(-3, "Expected type number", node.getnetworkhashpsseries, [{"nblocks": "1"}])
+
+    def _test_getblockhashes(self):
+        self.log.info("Test getblockhashes")
+        node = self.nodes[0]
+
+        def logical_times():
+            # A block's logical timestamp is its time, or one more than its
+            # parent's when that is not earlier.
+            times = []
+            for height in range(node.getblockcount() + 1):
+                header = node.getblockheader(node.getblockhash(height))
+                times.append((header["hash"], header["time"] if height == 0 else max(header["time"], times[-1][1] + 1)))
+            return times
+
+        def check(times, high, low):
+            expected = [(block_hash, time) for block_hash, time in times if low <= time < high]
+            result = node.getblockhashes(high, low, {"logicalTimes": True})
+            assert_equal([(entry["blockhash"], entry["logicalts"]) for entry in result], expected)
+            assert_equal(node.getblockhashes(high, low), [block_hash for block_hash, _ in expected])
+            assert_equal(node.getblockhashes(high, low, {"noOrphans": True}), [block_hash for block_hash, _ in expected])
+
+        # Blocks with the time of their parent get logical timestamps a second apart.
+        tip_time = node.getblockheader(node.getbestblockhash())["time"]
+        node.setmocktime(tip_time)
+        node.generatetoaddress(3, ADDRESS_BCRT1_P2WSH_OP_TRUE)
+        times = logical_times()
+        assert_equal([time for _, time in times[-4:]], [tip_time, tip_time + 1, tip_time + 2, tip_time + 3])
+        for high, low in [(2**31 - 1, 0), (tip_time + 2, tip_time), (times[100][1] + 1, times[100][1]),
+                          (times[50][1], times[50][1]), (times[10][1], times[20][1]), (times[-1][1] + 1, times[0][1] + 1)]:
+            check(times, high, low)
+
+        # After a reorg only the blocks of the new active chain are found.
+        node.invalidateblock(node.getblockhash(node.getblockcount() - 2))
+        node.setmocktime(tip_time + 100)
+        node.generatetoaddress(3, ADDRESS_BCRT1_P2WSH_OP_TRUE)
+        times = logical_times()
+        assert_equal([time for _, time in times[-4:]], [tip_time, tip_time + 100, tip_time + 101, tip_time + 102])
+        check(times, 2**31 - 1, tip_time)
+        check(times, tip_time + 101, 0)
+
     def _test_stopatheight(self):
         assert_equal(self.nodes[0].getblockcount(), 200)
         self.nodes[0].generatetoaddress(6, ADDRESS_BCRT1_P2WSH_OP_TRUE)
@@ -51,6 +51,13 @@ class GenerateBlockTest(MicroBitcoinTestFramework):
         assert_equal(len(block['tx']), 1)
         assert_equal(block['tx'][0]['vout'][0]['scriptPubKey']['address'], combo_address)
 
+        self.log.info('Generate blocks searching nonces on several threads')
+        hashes = node.generatetoaddress(2, address, 1000000, 4)
+        assert_equal(node.getbestblockhash(), hashes[-1])
+        hash = node.generateblock(address, [], 0)['hash']
+        assert_equal(node.getbestblockhash(), hash)
+        assert_raises_rpc_error(-8, 'Invalid number of threads, must be at least 0', node.generatetoaddress, 1, address, 1000000, -1)
+
         # Generate 110 blocks to spend
         node.generatetoaddress(110, address)
 
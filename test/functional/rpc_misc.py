@@ -54,6 +54,22 @@ class RpcMiscTest(MicroBitcoinTestFramework):
 
         assert_raises_rpc_error(-8, "unknown mode foobar", node.getmemoryinfo, mode="foobar")
 
+        self.log.info("test getmemoryinfo yespower scratchpads")
+        self.restart_node(0, ["-powscratchpads=2", "-nopowhugepages"])
+        node.generate(1)
+        memory = node.getmemoryinfo()['yespower']
+        assert_equal(memory['scratchpads'], 2)
+        assert_equal(memory['scratchpads_max'], 2)
+        assert_greater_than(memory['total'], 2 * 8 * 1024 * 1024)
+        assert_equal(memory['hugetlb'], 0)
+        assert_equal(memory['thp'], 0)
+        assert_greater_than_or_equal(memory['numa_nodes'], 1)
+        self.restart_node(0)
+        memory = node.getmemoryinfo()['yespower']
+        assert_greater_than_or_equal(memory['scratchpads'], 1)
+        assert_equal(memory['scratchpads'], memory['scratchpads_max'])
+        assert_greater_than_or_equal(memory['total'], memory['hugetlb'] + memory['thp'])
+
         self.log.info("test logging")
         assert_equal(node.logging()['qt'], True)
         node.logging(exclude=['qt'])